@@ -1,4 +1,4 @@
-for i in `ls levels | grep -v list`
+for i in `ls levels | grep -v list | grep -v hints | grep -v baked`
 do
   sed -i '' "s/\]$/\], \"$1\": \[\]/" levels/$i
 done
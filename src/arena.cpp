@@ -0,0 +1,79 @@
+#include "arena.hpp"
+
+
+void* Arena::alloc(const size_t size, const size_t align)
+{
+  // blocks past the current one are always empty, a rewind clears them
+  while (current < (int)blocks.size()) {
+    Block& block = blocks[current];
+    size_t from = (block.used + align - 1) & ~(align - 1);
+    if (from + size <= block.size) {
+      block.used = from + size;
+      return block.data + from;
+    }
+    current += 1;
+  }
+
+  Block block;
+  block.size = size + align > block_size ? size + align : block_size;
+  block.data = new uint8_t[block.size];
+  block.used = 0;
+  blocks.push_back(block);
+
+  return alloc(size, align);
+}
+
+
+Arena::Mark Arena::mark() const
+{
+  Mark m;
+  m.block = current;
+  m.used = current < (int)blocks.size() ? blocks[current].used : 0;
+  return m;
+}
+
+
+void Arena::rewind(const Mark& m)
+{
+  for (int i = m.block + 1; i < (int)blocks.size(); ++i) {
+    blocks[i].used = 0;
+  }
+  if (m.block < (int)blocks.size()) {
+    blocks[m.block].used = m.used;
+  }
+  current = m.block;
+}
+
+
+void Arena::reset()
+{
+  Mark start = {0, 0};
+  rewind(start);
+}
+
+
+void Arena::release()
+{
+  for (int i = 0; i < (int)blocks.size(); ++i) {
+    delete[] blocks[i].data;
+  }
+  blocks.clear();
+  current = 0;
+}
+
+
+size_t Arena::reserved() const
+{
+  size_t size = 0;
+  for (int i = 0; i < (int)blocks.size(); ++i) {
+    size += blocks[i].size;
+  }
+  return size;
+}
+
+
+Arena& Arena::run()
+{
+  static Arena arena;
+  return arena;
+}
@@ -0,0 +1,65 @@
+#ifndef ARENA
+#define ARENA
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Bump allocator over blocks it keeps until released. Nothing is freed on
+// its own: a scope rewinds to where it started, a reset to the start, and
+// the blocks are reused by whatever comes next, so the same allocations
+// after warm-up touch the heap no more. Memory is uninitialised, for plain
+// structs only.
+//
+// run() owns what lives as long as the application, the buffers' cpu
+// copies and models, which are sized once in World::prepare and rewritten
+// per level. Staging and scratch go in a scope, rewound once bgfx has its
+// copy or the caller is done.
+struct Arena
+{
+  struct Block
+  {
+    uint8_t* data;
+    size_t size;
+    size_t used;
+  };
+
+  struct Mark
+  {
+    int block;
+    size_t used;
+  };
+
+  // rewinds its arena on the way out
+  struct Scope
+  {
+    Arena& arena;
+    Mark mark;
+
+    Scope(Arena& _arena) : arena(_arena), mark(_arena.mark()) {}
+    ~Scope() { arena.rewind(mark); }
+  };
+
+  // bigger allocations get a block of their own size
+  size_t block_size = 1 << 20;
+  std::vector<Block> blocks;
+  int current = 0;
+
+  void* alloc(const size_t size, const size_t align = 16);
+  template<typename T>
+  T* alloc(const int count)
+  {
+    return (T*)alloc(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+  }
+
+  Mark mark() const;
+  void rewind(const Mark& m);
+  void reset();
+  void release();
+  size_t reserved() const;
+
+  static Arena& run();
+};
+
+#endif
@@ -0,0 +1,442 @@
+#include "baked.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+struct BakedHeader
+{
+  uint32_t version;
+  uint32_t layers_count;
+  uint64_t key;
+  uint32_t draws_count;
+  uint32_t instances_count;
+  uint32_t vertices_count;
+  uint32_t indices_count;
+  uint32_t index_size;
+  uint32_t pad;
+};
+
+
+// one per loaded file, unmapped once bgfx released every buffer made from it
+struct BakedMapping
+{
+  void* data;
+  size_t size;
+  std::atomic<int> refs;
+};
+
+
+static void releaseMapping(void* ptr, void* user_data)
+{
+  BakedMapping* mapping = (BakedMapping*)user_data;
+  if (--mapping->refs == 0) {
+    munmap(mapping->data, mapping->size);
+    delete mapping;
+  }
+}
+
+
+void Baked::clear()
+{
+  destroy();
+
+  // keep the capacity, the next level bakes into the same storage
+  draws.clear();
+  instances.clear();
+  vertices.clear();
+  indices.clear();
+  indices32.clear();
+
+  index32 = false;
+  for (int l = 0; l < (int)layers.size(); ++l) {
+    index32 = index32 || layers[l]->index32;
+  }
+}
+
+
+// draws outside the chunked layers are never culled
+static const float unbounded_min[3] = {-1e30f, -1e30f, -1e30f};
+static const float unbounded_max[3] = {1e30f, 1e30f, 1e30f};
+
+
+void Baked::copyLayer(const int layer, const int vertices_count, const int indices_count)
+{
+  const BufferObject& bo = *layers[layer];
+
+  layer_first_vertex = vertices.size();
+  layer_first_index = indicesCount();
+  layer_first_instance = instances.size();
+
+  vertices.insert(vertices.end(), bo.vertices, bo.vertices + vertices_count);
+  addIndices(bo, indices_count);
+  if (bo.instanced) {
+    instances.insert(instances.end(), bo.instances.begin(), bo.instances.end());
+  }
+}
+
+
+void Baked::addDraw
+(const int layer, const uint64_t state,
+ const int first_vertex, const int vertices_count,
+ const int first_index, const int indices_count,
+ const int first_instance, const int instances_count,
+ const float* min, const float* max)
+{
+  // nothing placed, or no instances of this model in the chunk
+  if (indices_count == 0 || (layers[layer]->instanced && instances_count == 0)) {
+    return;
+  }
+
+  Draw draw;
+  draw.layer = layer;
+  draw.first_vertex = layer_first_vertex + first_vertex;
+  draw.vertices_count = vertices_count;
+  draw.first_index = layer_first_index + first_index;
+  draw.indices_count = indices_count;
+  draw.first_instance = layer_first_instance + first_instance;
+  draw.instances_count = instances_count;
+  draw.pad = 0;
+  draw.state = state;
+  memcpy(draw.min, min, sizeof(draw.min));
+  memcpy(draw.max, max, sizeof(draw.max));
+
+  draws.push_back(draw);
+}
+
+
+void Baked::add(const int layer, const int vertices_count, const int indices_count, const uint64_t state)
+{
+  copyLayer(layer, vertices_count, indices_count);
+  addDraw(layer, state, 0, vertices_count, 0, indices_count, 0, 0, unbounded_min, unbounded_max);
+}
+
+
+void Baked::addModels(const int layer, const uint64_t state)
+{
+  const BufferObject& bo = *layers[layer];
+  const Models& models = bo.models;
+
+  if (!bo.instanced) {
+    add(layer, bo.models_vertices_count, bo.models_indices_count, state);
+    return;
+  }
+
+  // every mesh once, then a draw per placed model like RenderQueue::addModels
+  copyLayer(layer, models.vertices_offsets[models.models_count], models.indices_offsets[models.models_count]);
+
+  for (int nth = 0; nth < (int)bo.instances_counts.size(); ++nth) {
+    addDraw(layer, state,
+        models.vertices_offsets[nth], models.nth_model_vertices_count(nth),
+        models.indices_offsets[nth], models.nth_model_indices_count(nth),
+        bo.instances_offsets[nth], bo.instances_counts[nth],
+        unbounded_min, unbounded_max);
+  }
+}
+
+
+void Baked::addModelChunks(const int layer, const uint64_t state, const Chunking& chunking)
+{
+  const BufferObject& bo = *layers[layer];
+  const Models& models = bo.models;
+  const std::vector<int>& models_list = chunking.models_list;
+
+  if (!bo.instanced) {
+    copyLayer(layer, bo.models_vertices_count, bo.models_indices_count);
+
+    // written in chunk order, so each chunk's indices are one run
+    int vertices_end = 0;
+    int indices_end = 0;
+    for (int c = 0; c < (int)chunking.chunks.size(); ++c) {
+      const Chunking::Chunk& chunk = chunking.chunks[c];
+      int first_index = indices_end;
+
+      for (int i = chunk.from; i < chunk.to; ++i) {
+        vertices_end += models.nth_model_vertices_count(models_list[i]);
+        indices_end += models.nth_model_indices_count(models_list[i]);
+      }
+
+      addDraw(layer, state, 0, vertices_end, first_index, indices_end - first_index, 0, 0, chunk.min, chunk.max);
+    }
+    return;
+  }
+
+  copyLayer(layer, models.vertices_offsets[models.models_count], models.indices_offsets[models.models_count]);
+
+  // writeInstances keeps the chunk order within each model's run, so one
+  // chunk's instances of a model start where the previous chunk's ended
+  std::vector<int> cursors(bo.instances_offsets);
+  std::vector<int> counts(models.models_count);
+
+  for (int c = 0; c < (int)chunking.chunks.size(); ++c) {
+    const Chunking::Chunk& chunk = chunking.chunks[c];
+
+    std::fill(counts.begin(), counts.end(), 0);
+    for (int i = chunk.from; i < chunk.to; ++i) {
+      if (models_list[i] < models.models_count) {
+        counts[models_list[i]] += 1;
+      }
+    }
+
+    for (int nth = 0; nth < models.models_count; ++nth) {
+      addDraw(layer, state,
+          models.vertices_offsets[nth], models.nth_model_vertices_count(nth),
+          models.indices_offsets[nth], models.nth_model_indices_count(nth),
+          cursors[nth], counts[nth],
+          chunk.min, chunk.max);
+      cursors[nth] += counts[nth];
+    }
+  }
+}
+
+
+void Baked::addQuadChunks(const int layer, const uint64_t state, const Chunking& chunking)
+{
+  int quads_count = chunking.positions.size();
+  copyLayer(layer, quads_count * 4, quads_count * 6);
+
+  for (int c = 0; c < (int)chunking.chunks.size(); ++c) {
+    const Chunking::Chunk& chunk = chunking.chunks[c];
+    addDraw(layer, state, 0, chunk.to * 4, chunk.from * 6, (chunk.to - chunk.from) * 6, 0, 0, chunk.min, chunk.max);
+  }
+}
+
+
+void Baked::addIndices(const BufferObject& bo, const int indices_count)
+{
+  if (!index32) {
+    indices.insert(indices.end(), bo.indices, bo.indices + indices_count);
+  } else if (bo.index32) {
+    indices32.insert(indices32.end(), bo.indices32, bo.indices32 + indices_count);
+  } else {
+    indices32.insert(indices32.end(), bo.indices, bo.indices + indices_count);
+  }
+}
+
+
+int Baked::indicesCount() const
+{
+  return index32 ? indices32.size() : indices.size();
+}
+
+
+void Baked::build()
+{
+  destroy();
+
+  if (!vertices.empty()) {
+    m_vbh = bgfx::createVertexBuffer(
+        bgfx::copy(vertices.data(), vertices.size() * sizeof(PackedPosColorTexVertex)),
+        PackedPosColorTexVertex::ms_layout);
+  }
+  if (index32 && !indices32.empty()) {
+    m_ibh = bgfx::createIndexBuffer(bgfx::copy(indices32.data(), indices32.size() * sizeof(uint32_t)), BGFX_BUFFER_INDEX32);
+  } else if (!indices.empty()) {
+    m_ibh = bgfx::createIndexBuffer(bgfx::copy(indices.data(), indices.size() * sizeof(uint16_t)));
+  }
+  if (!instances.empty()) {
+    m_instances_vbh = bgfx::createVertexBuffer(
+        bgfx::copy(instances.data(), instances.size() * sizeof(InstanceData)),
+        InstanceData::ms_layout);
+  }
+
+  bound();
+  active = true;
+}
+
+
+void Baked::bound()
+{
+  boxes.clear();
+  for (int i = 0; i < (int)draws.size(); ++i) {
+    boxes.add(draws[i].min, draws[i].max);
+  }
+}
+
+
+void Baked::draw(bgfx::ViewId view, RenderQueue& queue, const Frustum* frustum)
+{
+  if (frustum) {
+    frustum->cull(boxes, visible);
+  }
+
+  for (int i = 0; i < (int)draws.size(); ++i) {
+    if (frustum && !visible[i]) {
+      continue;
+    }
+
+    const Draw& draw = draws[i];
+    BufferObject& bo = *layers[draw.layer];
+
+    RenderQueue::Item item;
+    memset(&item, 0, sizeof(item));
+    item.view = view;
+    item.state = draw.state;
+    item.program = bo.m_program;
+    item.textures = &bo.textures;
+    item.dynamic = false;
+    item.vbh = m_vbh.idx;
+    item.abh = bgfx::kInvalidHandle;
+    item.ibh = m_ibh.idx;
+    item.instances_vbh = m_instances_vbh.idx;
+    item.first_vertex = draw.first_vertex;
+    item.vertices_count = draw.vertices_count;
+    item.first_index = draw.first_index;
+    item.indices_count = draw.indices_count;
+    item.first_instance = draw.first_instance;
+    item.instances_count = draw.instances_count;
+
+    // unbounded draws have no centre worth sorting on
+    bool bounded = draw.min[0] > unbounded_min[0];
+    queue.add(item, bounded ? draw.min : NULL, bounded ? draw.max : NULL);
+  }
+}
+
+
+void Baked::destroy()
+{
+  if (bgfx::isValid(m_vbh)) {
+    bgfx::destroy(m_vbh);
+    m_vbh = BGFX_INVALID_HANDLE;
+  }
+  if (bgfx::isValid(m_ibh)) {
+    bgfx::destroy(m_ibh);
+    m_ibh = BGFX_INVALID_HANDLE;
+  }
+  if (bgfx::isValid(m_instances_vbh)) {
+    bgfx::destroy(m_instances_vbh);
+    m_instances_vbh = BGFX_INVALID_HANDLE;
+  }
+
+  active = false;
+}
+
+
+void Baked::path(char* str, const char* level_path)
+{
+  sprintf(str, "%s.baked", level_path);
+}
+
+
+bool Baked::load(const char* filename, const uint64_t key)
+{
+  clear();
+
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(BakedHeader)) {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  BakedHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  const char* draws_data = (const char*)data + sizeof(header);
+  const char* instances_data = draws_data + (size_t)header.draws_count * sizeof(Draw);
+  const char* vertices_data = instances_data + (size_t)header.instances_count * sizeof(InstanceData);
+  const char* indices_data = vertices_data + (size_t)header.vertices_count * sizeof(PackedPosColorTexVertex);
+  const char* end = indices_data + (size_t)header.indices_count * header.index_size;
+  uint32_t index_size = index32 ? sizeof(uint32_t) : sizeof(uint16_t);
+
+  // written by an older build, stale after the level or models changed, or cut short
+  if (header.version != current_version || header.key != key || header.layers_count != layers.size() ||
+      header.index_size != index_size || end - (const char*)data != st.st_size) {
+    munmap(data, st.st_size);
+    return false;
+  }
+
+  draws.resize(header.draws_count);
+  memcpy(draws.data(), draws_data, draws.size() * sizeof(Draw));
+
+  for (int i = 0; i < (int)draws.size(); ++i) {
+    if (draws[i].layer >= layers.size()) {
+      draws.clear();
+      munmap(data, st.st_size);
+      return false;
+    }
+  }
+
+  BakedMapping* mapping = new BakedMapping;
+  mapping->data = data;
+  mapping->size = st.st_size;
+  mapping->refs = 1;
+
+  // the buffers read straight from the mapping, no copy and no per vertex work
+  if (header.vertices_count > 0) {
+    mapping->refs += 1;
+    m_vbh = bgfx::createVertexBuffer(
+        bgfx::makeRef(vertices_data, header.vertices_count * sizeof(PackedPosColorTexVertex), releaseMapping, mapping),
+        PackedPosColorTexVertex::ms_layout);
+  }
+  if (header.indices_count > 0) {
+    mapping->refs += 1;
+    m_ibh = bgfx::createIndexBuffer(
+        bgfx::makeRef(indices_data, header.indices_count * index_size, releaseMapping, mapping),
+        index32 ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE);
+  }
+  if (header.instances_count > 0) {
+    mapping->refs += 1;
+    m_instances_vbh = bgfx::createVertexBuffer(
+        bgfx::makeRef(instances_data, header.instances_count * sizeof(InstanceData), releaseMapping, mapping),
+        InstanceData::ms_layout);
+  }
+  releaseMapping(NULL, mapping);
+
+  bound();
+  active = true;
+
+  return true;
+}
+
+
+void Baked::save(const char* filename, const uint64_t key) const
+{
+  BakedHeader header;
+  header.version = current_version;
+  header.layers_count = layers.size();
+  header.key = key;
+  header.draws_count = draws.size();
+  header.instances_count = instances.size();
+  header.vertices_count = vertices.size();
+  header.indices_count = indicesCount();
+  header.index_size = index32 ? sizeof(uint32_t) : sizeof(uint16_t);
+  header.pad = 0;
+
+  // written aside and renamed over, a file still mapped keeps its old pages
+  char tmp_str[255];
+  snprintf(tmp_str, sizeof(tmp_str), "%s.tmp", filename);
+
+  std::ofstream os(tmp_str, std::ios::binary);
+  os.write((const char*)&header, sizeof(header));
+  os.write((const char*)draws.data(), draws.size() * sizeof(Draw));
+  os.write((const char*)instances.data(), instances.size() * sizeof(InstanceData));
+  os.write((const char*)vertices.data(), vertices.size() * sizeof(PackedPosColorTexVertex));
+  if (index32) {
+    os.write((const char*)indices32.data(), indices32.size() * sizeof(uint32_t));
+  } else {
+    os.write((const char*)indices.data(), indices.size() * sizeof(uint16_t));
+  }
+  os.close();
+
+  if (!os) {
+    remove(tmp_str);
+    return;
+  }
+  rename(tmp_str, filename);
+}
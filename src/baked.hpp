@@ -0,0 +1,96 @@
+#ifndef BAKED
+#define BAKED
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <bgfx/bgfx.h>
+
+#include "buffer_object.hpp"
+#include "chunking.hpp"
+#include "frustum.hpp"
+#include "render_queue.hpp"
+
+// The layers that only change when a level loads or in the editor, copied
+// out of their BufferObjects into one immutable vertex/index buffer pair,
+// plus one immutable instance buffer for the instanced layers. Each draw
+// keeps its ranges and state and takes program and textures from its
+// layer, in add order. Indices stay local to their mesh, draws offset the
+// vertex buffer instead.
+//
+// Indices are 32 bit when any layer's are, 16 bit otherwise. Chunked
+// layers get a draw per chunk with its bounds, culled against the view
+// before queueing, the other draws are unbounded.
+//
+// Saved next to the level as "<level>.baked" and mmapped back, the mapping
+// goes to bgfx as is. On disk: version, key, layer, draw, instance, vertex
+// and index counts, index size, then the draws, instances, vertices and
+// indices, all native endian. The caller sets layers before clearing,
+// adding or loading.
+struct Baked
+{
+  struct Draw
+  {
+    uint32_t layer;
+    uint32_t first_vertex;
+    uint32_t vertices_count;
+    uint32_t first_index;
+    uint32_t indices_count;
+    uint32_t first_instance;
+    uint32_t instances_count;
+    uint32_t pad;
+    uint64_t state;
+    float min[3];
+    float max[3];
+  };
+
+  static const uint32_t current_version = 3;
+
+  std::vector<BufferObject*> layers;
+  std::vector<Draw> draws;
+  std::vector<InstanceData> instances;
+  std::vector<PackedPosColorTexVertex> vertices;
+  bool index32 = false;
+  std::vector<uint16_t> indices;
+  std::vector<uint32_t> indices32;
+
+  bgfx::VertexBufferHandle m_vbh = BGFX_INVALID_HANDLE;
+  bgfx::IndexBufferHandle m_ibh = BGFX_INVALID_HANDLE;
+  bgfx::VertexBufferHandle m_instances_vbh = BGFX_INVALID_HANDLE;
+  // built or loaded and not destroyed since, an empty level is still active
+  bool active = false;
+
+  // the draws' bounds, and which passed the last cull
+  Frustum::Boxes boxes;
+  std::vector<uint8_t> visible;
+
+  // where the layer copied last starts, draws are added relative to it
+  uint32_t layer_first_vertex = 0;
+  uint32_t layer_first_index = 0;
+  uint32_t layer_first_instance = 0;
+
+  void clear();
+  void copyLayer(const int layer, const int vertices_count, const int indices_count);
+  void addDraw
+    (const int layer, const uint64_t state,
+     const int first_vertex, const int vertices_count,
+     const int first_index, const int indices_count,
+     const int first_instance, const int instances_count,
+     const float* min, const float* max);
+  void add(const int layer, const int vertices_count, const int indices_count, const uint64_t state);
+  void addModels(const int layer, const uint64_t state);
+  void addModelChunks(const int layer, const uint64_t state, const Chunking& chunking);
+  void addQuadChunks(const int layer, const uint64_t state, const Chunking& chunking);
+  void addIndices(const BufferObject& bo, const int indices_count);
+  int indicesCount() const;
+  void build();
+  void bound();
+  void draw(bgfx::ViewId view, RenderQueue& queue, const Frustum* frustum);
+  void destroy();
+
+  static void path(char* str, const char* level_path);
+  bool load(const char* filename, const uint64_t key);
+  void save(const char* filename, const uint64_t key) const;
+};
+
+#endif
@@ -1,6 +1,13 @@
 #include "buffer_object.hpp"
+#include "arena.hpp"
+#include <algorithm>
+#include <bx/simd_t.h>
+#include <string.h>
 
-bgfx::VertexLayout AnimatedPosColorTexVertex::ms_layout;
+
+bgfx::VertexLayout PackedPosColorTexVertex::ms_layout;
+bgfx::VertexLayout AnimationVertex::ms_layout;
+bgfx::VertexLayout InstanceData::ms_layout;
 
 
 void BufferObject::initCubes(const int cubes_count)
@@ -8,8 +15,8 @@ void BufferObject::initCubes(const int cubes_count)
   vertices_count = cubes_count * vertices_per_cube_count;
   indices_count = cubes_count * indices_per_lines_cube_count;
 
-  vertices = new AnimatedPosColorTexVertex[vertices_count];
-  indices = new uint16_t[indices_count];
+  vertices = Arena::run().alloc<PackedPosColorTexVertex>(vertices_count);
+  allocIndices();
 
   writeCubesIndices();
 }
@@ -20,8 +27,8 @@ void BufferObject::initCubesLines(const int cubes_count)
   vertices_count = cubes_count * vertices_per_lines_cube_count;
   indices_count = cubes_count * vertices_per_lines_cube_count;
 
-  vertices = new AnimatedPosColorTexVertex[vertices_count];
-  indices = new uint16_t[indices_count];
+  vertices = Arena::run().alloc<PackedPosColorTexVertex>(vertices_count);
+  allocIndices();
 
   writeCubesLinesIndices();
 }
@@ -29,26 +36,30 @@ void BufferObject::initCubesLines(const int cubes_count)
 
 void BufferObject::writeCubesIndices()
 {
+  markIndices(0, indices_count);
+
   for (int i = 0; i < indices_count / indices_per_face_count; ++i) {
-    indices[i * indices_per_face_count + 0] = i * vertices_per_face_count + 0;
-    indices[i * indices_per_face_count + 1] = i * vertices_per_face_count + 1;
-    indices[i * indices_per_face_count + 2] = i * vertices_per_face_count + 3;
-    indices[i * indices_per_face_count + 3] = i * vertices_per_face_count + 1;
-    indices[i * indices_per_face_count + 4] = i * vertices_per_face_count + 2;
-    indices[i * indices_per_face_count + 5] = i * vertices_per_face_count + 3;
+    setIndex(i * indices_per_face_count + 0, i * vertices_per_face_count + 0);
+    setIndex(i * indices_per_face_count + 1, i * vertices_per_face_count + 1);
+    setIndex(i * indices_per_face_count + 2, i * vertices_per_face_count + 3);
+    setIndex(i * indices_per_face_count + 3, i * vertices_per_face_count + 1);
+    setIndex(i * indices_per_face_count + 4, i * vertices_per_face_count + 2);
+    setIndex(i * indices_per_face_count + 5, i * vertices_per_face_count + 3);
   }
 }
 
 
 void BufferObject::writeCubesLinesIndices()
 {
+  markIndices(0, indices_count);
+
   for (int i = 0; i < indices_count / indices_per_lines_face_count; ++i) {
-    indices[i * indices_per_lines_face_count + 0] = i * vertices_per_lines_face_count + 0;
-    indices[i * indices_per_lines_face_count + 1] = i * vertices_per_lines_face_count + 1;
-    indices[i * indices_per_lines_face_count + 2] = i * vertices_per_lines_face_count + 0;
-    indices[i * indices_per_lines_face_count + 3] = i * vertices_per_lines_face_count + 3;
-    indices[i * indices_per_lines_face_count + 4] = i * vertices_per_lines_face_count + 1;
-    indices[i * indices_per_lines_face_count + 5] = i * vertices_per_lines_face_count + 2;
+    setIndex(i * indices_per_lines_face_count + 0, i * vertices_per_lines_face_count + 0);
+    setIndex(i * indices_per_lines_face_count + 1, i * vertices_per_lines_face_count + 1);
+    setIndex(i * indices_per_lines_face_count + 2, i * vertices_per_lines_face_count + 0);
+    setIndex(i * indices_per_lines_face_count + 3, i * vertices_per_lines_face_count + 3);
+    setIndex(i * indices_per_lines_face_count + 4, i * vertices_per_lines_face_count + 1);
+    setIndex(i * indices_per_lines_face_count + 5, i * vertices_per_lines_face_count + 2);
   }
 }
 
@@ -56,59 +67,15 @@ void BufferObject::writeCubesLinesIndices()
 void BufferObject::writeCubeVertices(int nth_cube, bx::Vec3 pos, bx::Vec3 col)
 {
   offset = nth_cube * vertices_per_cube_count;
+  markVertices(offset, vertices_per_cube_count);
 
   for (int i = 0; i < vertices_per_cube_count; ++i) {
     end_pos = bx::add(pos_vertices[i], pos);
+    normal = cube_normals[i / vertices_per_face_count];
 
-    vertices[offset + i].x = end_pos.x;
-    vertices[offset + i].y = end_pos.y;
-    vertices[offset + i].z = end_pos.z;
-    vertices[offset + i].r = col.x;
-    vertices[offset + i].g = col.y;
-    vertices[offset + i].b = col.z;
-  }
-
-  for(int i = 0; i < vertices_per_cube_count; i += 4) {
-    a = bx::Vec3(
-        vertices[offset + i + 0].x,
-        vertices[offset + i + 0].y,
-        vertices[offset + i + 0].z
-        );
-    b = bx::Vec3(
-        vertices[offset + i + 1].x,
-        vertices[offset + i + 1].y,
-        vertices[offset + i + 1].z
-        );
-    c = bx::Vec3(
-        vertices[offset + i + 3].x,
-        vertices[offset + i + 3].y,
-        vertices[offset + i + 3].z
-        );
-
-    normal = bx::normalize(
-        bx::cross(
-          bx::sub(a, b),
-          bx::sub(a, c)
-          )
-        );
-
-    vertices[offset + i + 0].normal_x =
-      vertices[offset + i + 1].normal_x =
-      vertices[offset + i + 2].normal_x =
-      vertices[offset + i + 3].normal_x =
-      normal.x;
-
-    vertices[offset + i + 0].normal_y =
-      vertices[offset + i + 1].normal_y =
-      vertices[offset + i + 2].normal_y =
-      vertices[offset + i + 3].normal_y =
-      normal.y;
-
-    vertices[offset + i + 0].normal_z =
-      vertices[offset + i + 1].normal_z =
-      vertices[offset + i + 2].normal_z =
-      vertices[offset + i + 3].normal_z =
-      normal.z;
+    vertices[offset + i].setPosition(end_pos.x, end_pos.y, end_pos.z);
+    vertices[offset + i].setColor(col.x, col.y, col.z);
+    vertices[offset + i].setNormal(normal.x, normal.y, normal.z);
   }
 }
 
@@ -116,16 +83,13 @@ void BufferObject::writeCubeLinesVertices(int nth_cube, bx::Vec3 pos, bx::Vec3 c
 {
   bx::Vec3 end_pos;
   int offset = nth_cube * vertices_per_lines_cube_count;
+  markVertices(offset, vertices_per_lines_cube_count);
 
   for (int i = 0; i < vertices_per_lines_cube_count; ++i) {
     end_pos = bx::add(pos_lines_vertices[i], pos);
 
-    vertices[offset + i].x = end_pos.x;
-    vertices[offset + i].y = end_pos.y;
-    vertices[offset + i].z = end_pos.z;
-    vertices[offset + i].r = col.x;
-    vertices[offset + i].g = col.y;
-    vertices[offset + i].b = col.z;
+    vertices[offset + i].setPosition(end_pos.x, end_pos.y, end_pos.z);
+    vertices[offset + i].setColor(col.x, col.y, col.z);
   }
 }
 
@@ -133,33 +97,202 @@ void BufferObject::setFaceColor(const int nth_cube, const int nth_face, bx::Vec3
 {
   int offset = nth_cube * vertices_per_cube_count;
   int face_offset = nth_face * vertices_per_face_count;
+  markVertices(offset + face_offset, vertices_per_face_count);
 
   for (int i = 0; i < vertices_per_face_count; ++i) {
-    vertices[offset + face_offset + i].r = col.x;
-    vertices[offset + face_offset + i].g = col.y;
-    vertices[offset + face_offset + i].b = col.z;
+    vertices[offset + face_offset + i].setColor(col.x, col.y, col.z);
   }
 }
 
 void BufferObject::createBuffers()
 {
+  if (animations) {
+    u_animation = bgfx::createUniform("animation", bgfx::UniformType::Vec4, max_animated_objects * 4);
+  }
+
+  transient = transient && !index32 && !instanced;
+  if (transient) {
+    dirty_vertices.clear();
+    dirty_indices.clear();
+    return;
+  }
+
   m_vbh = bgfx::createDynamicVertexBuffer(
               // Static data can be passed with bgfx::makeRef
               bgfx::makeRef(vertices, vertices_count * sizeof(vertices[0])),
-              AnimatedPosColorTexVertex::ms_layout
+              PackedPosColorTexVertex::ms_layout
           );
 
+  if (animations) {
+    m_abh = bgfx::createDynamicVertexBuffer(
+                bgfx::makeRef(animations, vertices_count * sizeof(animations[0])),
+                AnimationVertex::ms_layout
+            );
+  }
+
   m_ibh = bgfx::createDynamicIndexBuffer(
               // Static data can be passed with bgfx::makeRef
-              bgfx::makeRef(indices, indices_count * sizeof(indices[0]))
-              // bgfx::makeRef(indices, 6 * sizeof(indices[0]))
+              bgfx::makeRef(indexData(0), indices_count * indexSize()),
+              index32 ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE
           );
+
+  // creation sent everything written so far
+  dirty_vertices.clear();
+  dirty_indices.clear();
 }
 
 void BufferObject::updateBuffer()
 {
-  bgfx::update(m_vbh, 0, bgfx::makeRef(vertices, vertices_count * sizeof(vertices[0])));
-  bgfx::update(m_ibh, 0, bgfx::makeRef(indices, indices_count * sizeof(indices[0])));
+  if (transient) {
+    dirty_vertices.clear();
+    dirty_indices.clear();
+    return;
+  }
+
+  merge(dirty_vertices, vertices_count);
+  merge(dirty_indices, indices_count);
+
+  for (int i = 0; i < (int)dirty_vertices.size(); ++i) {
+    const Span& span = dirty_vertices[i];
+    bgfx::update(m_vbh, span.from, bgfx::makeRef(vertices + span.from, (span.to - span.from) * sizeof(vertices[0])));
+    if (animations) {
+      bgfx::update(m_abh, span.from, bgfx::makeRef(animations + span.from, (span.to - span.from) * sizeof(animations[0])));
+    }
+  }
+
+  for (int i = 0; i < (int)dirty_indices.size(); ++i) {
+    const Span& span = dirty_indices[i];
+    bgfx::update(m_ibh, span.from, bgfx::makeRef(indexData(span.from), (span.to - span.from) * indexSize()));
+  }
+
+  dirty_vertices.clear();
+  dirty_indices.clear();
+}
+
+
+bool BufferObject::allocTransient(const uint32_t current_vertices_count, const uint32_t current_indices_count)
+{
+  // all or nothing, out of room the layer skips a frame. Check every stream
+  // before allocating any so a failure does not eat into the frame's pools
+  const bgfx::VertexLayout& layout = PackedPosColorTexVertex::ms_layout;
+  if (bgfx::getAvailTransientIndexBuffer(current_indices_count) < current_indices_count
+      || bgfx::getAvailTransientVertexBuffer(current_vertices_count, layout) < current_vertices_count) {
+    return false;
+  }
+
+  if (animations) {
+    // both vertex streams come out of the transient vertex pool, so ask for
+    // their summed stride at once. One extra vertex covers the alignment
+    // padding in front of each stream
+    bgfx::VertexLayout both;
+    both.begin().skip(layout.getStride() + AnimationVertex::ms_layout.getStride()).end();
+    if (bgfx::getAvailTransientVertexBuffer(current_vertices_count + 1, both) < current_vertices_count + 1) {
+      return false;
+    }
+  }
+
+  bgfx::allocTransientBuffers(&m_tvb, layout, current_vertices_count, &m_tib, current_indices_count);
+  bx::memCopy(m_tvb.data, vertices, current_vertices_count * sizeof(vertices[0]));
+  bx::memCopy(m_tib.data, indices, current_indices_count * sizeof(indices[0]));
+
+  m_tab.handle = BGFX_INVALID_HANDLE;
+  if (animations) {
+    bgfx::allocTransientVertexBuffer(&m_tab, current_vertices_count, AnimationVertex::ms_layout);
+    bx::memCopy(m_tab.data, animations, current_vertices_count * sizeof(animations[0]));
+  }
+
+  return true;
+}
+
+
+void BufferObject::allocIndices()
+{
+  // past what 16 bits address, models further in would wrap around
+  index32 = vertices_count > 0xffff;
+
+  if (index32) {
+    indices32 = Arena::run().alloc<uint32_t>(indices_count);
+  } else {
+    indices = Arena::run().alloc<uint16_t>(indices_count);
+  }
+}
+
+
+const void* BufferObject::indexData(const int from) const
+{
+  if (index32) {
+    return indices32 + from;
+  }
+  return indices + from;
+}
+
+
+int BufferObject::indexSize() const
+{
+  return index32 ? sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+
+void BufferObject::markVertices(const int from, const int count)
+{
+  mark(dirty_vertices, from, from + count);
+}
+
+
+void BufferObject::markIndices(const int from, const int count)
+{
+  mark(dirty_indices, from, from + count);
+}
+
+
+void BufferObject::mark(std::vector<Span>& spans, const int from, const int to)
+{
+  if (from >= to) {
+    return;
+  }
+
+  // writes mostly run front to back, so grow the last span when touching
+  if (!spans.empty() && from <= spans.back().to && to >= spans.back().from) {
+    spans.back().from = bx::min(spans.back().from, from);
+    spans.back().to = bx::max(spans.back().to, to);
+    return;
+  }
+
+  spans.push_back(Span{from, to});
+}
+
+
+static bool spanBefore(const BufferObject::Span& a, const BufferObject::Span& b)
+{
+  return a.from < b.from;
+}
+
+
+void BufferObject::merge(std::vector<Span>& spans, const int capacity)
+{
+  if (spans.empty()) {
+    return;
+  }
+
+  std::sort(spans.begin(), spans.end(), spanBefore);
+
+  int merged = 0;
+  for (int i = 1; i < (int)spans.size(); ++i) {
+    if (spans[i].from <= spans[merged].to) {
+      spans[merged].to = bx::max(spans[merged].to, spans[i].to);
+    } else {
+      spans[++merged] = spans[i];
+    }
+  }
+  spans.resize(merged + 1);
+
+  // never past the buffer, whatever a writer claimed
+  while (!spans.empty() && spans.back().from >= capacity) {
+    spans.pop_back();
+  }
+  if (!spans.empty()) {
+    spans.back().to = bx::min(spans.back().to, capacity);
+  }
 }
 
 void BufferObject::createShaders(const char* vertex_shader_path, const char* fragment_shader_path)
@@ -170,19 +303,19 @@ void BufferObject::createShaders(const char* vertex_shader_path, const char* fra
   m_program = bgfx::createProgram(vsh, fsh, false);
 }
 
-void BufferObject::draw(bgfx::ViewId view, uint16_t current_vertices_count, uint16_t current_indices_count, uint64_t more_state = 0)
+void BufferObject::draw(bgfx::ViewId view, uint32_t current_vertices_count, uint32_t current_indices_count, uint64_t more_state = 0)
 {
-  bgfx::setState(0
-      | BGFX_STATE_WRITE_R
-      | BGFX_STATE_WRITE_G
-      | BGFX_STATE_WRITE_B
-      | BGFX_STATE_WRITE_A
-      | BGFX_STATE_WRITE_Z
-      | BGFX_STATE_DEPTH_TEST_LESS
-      | BGFX_STATE_CULL_CCW
-      | BGFX_STATE_MSAA
-      | more_state
-      );
+  // on the main thread begin hands out the encoder the global calls use
+  draw(bgfx::begin(), view, current_vertices_count, current_indices_count, more_state);
+}
+
+
+void BufferObject::draw
+(bgfx::Encoder* encoder, bgfx::ViewId view, uint32_t current_vertices_count, uint32_t current_indices_count, uint64_t more_state)
+{
+  if (transient && !allocTransient(current_vertices_count, current_indices_count)) {
+    return;
+  }
 
   // printf("\nvertices:\n");
   // for(int i = 0; i < current_vertices_count; ++i) {
@@ -194,11 +327,64 @@ void BufferObject::draw(bgfx::ViewId view, uint16_t current_vertices_count, uint
   // }
   // printf("\n\n");
 
-  bgfx::setVertexBuffer(0, m_vbh, 0, current_vertices_count);
-  bgfx::setIndexBuffer(m_ibh, 0, current_indices_count);
-  textures.setTexture();
+  // animated buffers submit a group of models at a time, the rest once
+  AnimationGroup group = {0, current_indices_count, NULL, 0};
+  int groups_count = animations ? animationGroupsCount() : 1;
 
-  bgfx::submit(view, m_program);
+  for (int g = 0; g < groups_count; ++g) {
+    if (animations) {
+      group = animationGroup(g, current_indices_count);
+      if (group.indices_count == 0) {
+        continue;
+      }
+    }
+
+    encoder->setState(draw_state | more_state);
+    if (transient) {
+      encoder->setVertexBuffer(0, &m_tvb, 0, current_vertices_count);
+      if (animations) {
+        encoder->setVertexBuffer(1, &m_tab, 0, current_vertices_count);
+      }
+      encoder->setIndexBuffer(&m_tib, group.first_index, group.indices_count);
+    } else {
+      encoder->setVertexBuffer(0, m_vbh, 0, current_vertices_count);
+      if (animations) {
+        encoder->setVertexBuffer(1, m_abh, 0, current_vertices_count);
+      }
+      encoder->setIndexBuffer(m_ibh, group.first_index, group.indices_count);
+    }
+    if (group.records_num > 0) {
+      encoder->setUniform(u_animation, group.records, group.records_num);
+    }
+    textures.setTexture(encoder);
+
+    encoder->submit(view, m_program);
+  }
+}
+
+
+int BufferObject::animationGroupsCount() const
+{
+  return (animated_objects_count + max_animated_objects - 1) / max_animated_objects;
+}
+
+
+BufferObject::AnimationGroup BufferObject::animationGroup(const int group, const uint32_t current_indices_count) const
+{
+  // models are written in order, a group runs to where the next one starts
+  int from = group * max_animated_objects;
+  int to = bx::min(from + max_animated_objects, animated_objects_count);
+
+  uint32_t first_index = bx::min<uint32_t>(animated_meshes[from].indices_offset, current_indices_count);
+  uint32_t end_index = to < animated_objects_count ? animated_meshes[to].indices_offset : current_indices_count;
+  end_index = bx::max(first_index, bx::min(end_index, current_indices_count));
+
+  AnimationGroup result;
+  result.first_index = first_index;
+  result.indices_count = end_index - first_index;
+  result.records = &animation_records[from];
+  result.records_num = (to - from) * 4;
+  return result;
 }
 
 void BufferObject::drawCubes(bgfx::ViewId view, uint16_t current_cubes_count, uint64_t more_state)
@@ -213,8 +399,16 @@ void BufferObject::drawCubesLines(bgfx::ViewId view, uint16_t current_cubes_coun
 
 void BufferObject::destroy()
 {
-  bgfx::destroy(m_vbh);
-  bgfx::destroy(m_ibh);
+  if (!transient) {
+    bgfx::destroy(m_vbh);
+    if (animations) {
+      bgfx::destroy(m_abh);
+    }
+    bgfx::destroy(m_ibh);
+  }
+  if (animations) {
+    bgfx::destroy(u_animation);
+  }
   bgfx::destroy(m_program);
 }
 
@@ -225,14 +419,16 @@ void BufferObject::initModels(const int models_count)
   vertices_count = models_count * 1000;
   indices_count = models_count * 1000;
 
-  vertices = new AnimatedPosColorTexVertex[vertices_count];
-  indices = new uint16_t[indices_count];
+  vertices = Arena::run().alloc<PackedPosColorTexVertex>(vertices_count);
+  allocIndices();
 }
 
 
-void BufferObject::drawModels(bgfx::ViewId view, uint64_t more_state = 0)
+void BufferObject::initAnimatedModels(const int models_count)
 {
-  draw(view, models_vertices_count, models_indices_count, more_state);
+  initModels(models_count);
+
+  animations = Arena::run().alloc<AnimationVertex>(vertices_count);
 }
 
 
@@ -240,111 +436,208 @@ void BufferObject::writeModelVertices
 (const int offset, bx::Vec3 pos, bx::Vec3 col, const int nth)
 {
   int nth_model_vertices_count = models.nth_model_vertices_count(nth);
-
-  for (int i = 0; i < nth_model_vertices_count; ++i) {
-    vertices[offset + i].x = models.vertices[models.vertices_offsets[nth] + i].x;
-    vertices[offset + i].y = models.vertices[models.vertices_offsets[nth] + i].y;
-    vertices[offset + i].z = models.vertices[models.vertices_offsets[nth] + i].z;
-    vertices[offset + i].r = col.x + models.vertices[models.vertices_offsets[nth] + i].r;
-    vertices[offset + i].g = col.y + models.vertices[models.vertices_offsets[nth] + i].g;
-    vertices[offset + i].b = col.z + models.vertices[models.vertices_offsets[nth] + i].b;
-    vertices[offset + i].normal_x = models.vertices[models.vertices_offsets[nth] + i].normal_x;
-    vertices[offset + i].normal_y = models.vertices[models.vertices_offsets[nth] + i].normal_y;
-    vertices[offset + i].normal_z = models.vertices[models.vertices_offsets[nth] + i].normal_z;
-
-    vertices[offset + i].x2 = models.vertices[models.vertices_offsets[nth] + i].x;
-    vertices[offset + i].y2 = models.vertices[models.vertices_offsets[nth] + i].y;
-    vertices[offset + i].z2 = models.vertices[models.vertices_offsets[nth] + i].z;
-    vertices[offset + i].r2 = col.x + models.vertices[models.vertices_offsets[nth] + i].r;
-    vertices[offset + i].g2 = col.y + models.vertices[models.vertices_offsets[nth] + i].g;
-    vertices[offset + i].b2 = col.z + models.vertices[models.vertices_offsets[nth] + i].b;
-    vertices[offset + i].normal_x2 = models.vertices[models.vertices_offsets[nth] + i].normal_x;
-    vertices[offset + i].normal_y2 = models.vertices[models.vertices_offsets[nth] + i].normal_y;
-    vertices[offset + i].normal_z2 = models.vertices[models.vertices_offsets[nth] + i].normal_z;
-
-    vertices[offset + i].pos_x1 = pos.x;
-    vertices[offset + i].pos_y1 = pos.y;
-    vertices[offset + i].pos_z1 = pos.z;
-
-    vertices[offset + i].pos_x2 = pos.x;
-    vertices[offset + i].pos_y2 = pos.y;
-    vertices[offset + i].pos_z2 = pos.z;
-
-    vertices[offset + i].pos_from = 0.0f;
-    vertices[offset + i].pos_to = 0.0f;
-
-    vertices[offset + i].color_from = 0.0f;
-    vertices[offset + i].color_to = 0.0f;
-
-    vertices[offset + i].model_from = 0.0f;
-    vertices[offset + i].model_to = 0.0f;
-
-    vertices[offset + i].texcoord_x1 = models.vertices[models.vertices_offsets[nth] + i].texcoord_x1;
-    vertices[offset + i].texcoord_y1 = models.vertices[models.vertices_offsets[nth] + i].texcoord_y1;
-
-    vertices[offset + i].texcoord_x2 = models.vertices[models.vertices_offsets[nth] + i].texcoord_x1;
-    vertices[offset + i].texcoord_y2 = models.vertices[models.vertices_offsets[nth] + i].texcoord_y1;
-  }
+  const PosColorTexVertex* model = &models.vertices[models.vertices_offsets[nth]];
+  markVertices(offset, nth_model_vertices_count);
+  expandModel(&vertices[offset], model, nth_model_vertices_count, pos, col);
 
   // if (nth_model_vertices_count + offset > models_vertices_count) {
   models_vertices_count = nth_model_vertices_count + offset;
 }
 
 
-void BufferObject::writeModelVertices
-(const int offset, const bx::Vec3 pos1, const bx::Vec3 pos2,
+void BufferObject::expandModelScalar
+(PackedPosColorTexVertex* dst, const PosColorTexVertex* src, const int count, const bx::Vec3 pos, const bx::Vec3 col)
+{
+  for (int i = 0; i < count; ++i) {
+    dst[i].setPosition(pos.x + src[i].x, pos.y + src[i].y, pos.z + src[i].z);
+    dst[i].setColor(col.x + src[i].r, col.y + src[i].g, col.z + src[i].b);
+    dst[i].setNormal(src[i].normal_x, src[i].normal_y, src[i].normal_z);
+    dst[i].setTexcoord(src[i].texcoord_x1, src[i].texcoord_y1);
+    dst[i].pad0 = 0;
+    dst[i].pad1 = 0;
+  }
+}
+
+
+// bx's simd wrappers only add up to a few instructions once optimised,
+// unoptimised builds are several times faster with the scalar loop
+#if BX_CONFIG_SUPPORTS_SIMD && defined(__OPTIMIZE__)
+#define EXPAND_SIMD 1
+#else
+#define EXPAND_SIMD 0
+#endif
+
+const bool BufferObject::expand_simd = EXPAND_SIMD;
+
+
+#if EXPAND_SIMD
+// PackedPosColorTexVertex::half on each lane
+static BX_SIMD_FORCE_INLINE bx::simd128_t halfs(const bx::simd128_t v)
+{
+  using namespace bx;
+
+  const simd128_t sign = simd_and(simd_srl(v, 16), simd_isplat(0x8000));
+  const simd128_t exponent = simd_isub(simd_and(simd_srl(v, 23), simd_isplat(0xff)), simd_isplat(127 - 15));
+  const simd128_t mantissa = simd_and(v, simd_isplat(0x7fffff));
+
+  simd128_t half = simd_or(simd_sll(exponent, 10), simd_srl(mantissa, 13));
+  half = simd_or(sign, simd_iadd(half, simd_and(simd_srl(mantissa, 12), simd_isplat(1))));
+  half = simd_selb(simd_icmplt(exponent, simd_isplat(1)), sign, half);
+  half = simd_selb(simd_icmpgt(exponent, simd_isplat(30)), simd_or(sign, simd_isplat(0x7c00)), half);
+  return half;
+}
+
+
+// PackedPosColorTexVertex::unorm8 on each lane
+static BX_SIMD_FORCE_INLINE bx::simd128_t unorm8s(const bx::simd128_t v)
+{
+  using namespace bx;
+
+  const simd128_t clamped = simd_clamp(v, simd_zero<simd128_t>(), simd_splat<simd128_t>(1.0f));
+  // floored first, simd_ftoi rounds on sse but truncates elsewhere
+  return simd_ftoi(simd_floor(simd_add(simd_mul(clamped, simd_splat<simd128_t>(255.0f)), simd_splat<simd128_t>(0.5f))));
+}
+
+
+// PackedPosColorTexVertex::snorm16 on each lane, in the low 16 bits
+static BX_SIMD_FORCE_INLINE bx::simd128_t snorm16s(const bx::simd128_t v)
+{
+  using namespace bx;
+
+  const simd128_t clamped = simd_clamp(v, simd_splat<simd128_t>(-1.0f), simd_splat<simd128_t>(1.0f));
+  const simd128_t magnitude = simd_ftoi(simd_floor(
+        simd_add(simd_mul(simd_abs(clamped), simd_splat<simd128_t>(32767.0f)), simd_splat<simd128_t>(0.5f))));
+  // rounds away from 0 on both sides like the scalar one
+  const simd128_t negative = simd_cmplt(clamped, simd_zero<simd128_t>());
+  const simd128_t snorm = simd_selb(negative, simd_isub(simd_zero<simd128_t>(), magnitude), magnitude);
+  return simd_and(snorm, simd_isplat(0xffff));
+}
+#endif
+
+
+void BufferObject::expandModel
+(PackedPosColorTexVertex* dst, const PosColorTexVertex* src, const int count, const bx::Vec3 pos, const bx::Vec3 col)
+{
+  int i = 0;
+
+#if EXPAND_SIMD
+  using namespace bx;
+
+  const simd128_t px = simd_splat<simd128_t>(pos.x);
+  const simd128_t py = simd_splat<simd128_t>(pos.y);
+  const simd128_t pz = simd_splat<simd128_t>(pos.z);
+  const simd128_t cr = simd_splat<simd128_t>(col.x);
+  const simd128_t cg = simd_splat<simd128_t>(col.y);
+  const simd128_t cb = simd_splat<simd128_t>(col.z);
+  const simd128_t alpha = simd_isplat(0xff000000);
+
+  // a vertex per lane, each packed vertex is six little endian 32 bit words
+  BX_STATIC_ASSERT(sizeof(PackedPosColorTexVertex) == sizeof(uint32_t) * 6);
+  BX_ALIGN_DECL_16(uint32_t packed[4 * 6]);
+
+  for (; i + 4 <= count; i += 4) {
+    const PosColorTexVertex* s = &src[i];
+
+    const simd128_t x = halfs(simd_add(px, simd_ld<simd128_t>(s[0].x, s[1].x, s[2].x, s[3].x)));
+    const simd128_t y = halfs(simd_add(py, simd_ld<simd128_t>(s[0].y, s[1].y, s[2].y, s[3].y)));
+    const simd128_t z = halfs(simd_add(pz, simd_ld<simd128_t>(s[0].z, s[1].z, s[2].z, s[3].z)));
+    const simd128_t r = unorm8s(simd_add(cr, simd_ld<simd128_t>(s[0].r, s[1].r, s[2].r, s[3].r)));
+    const simd128_t g = unorm8s(simd_add(cg, simd_ld<simd128_t>(s[0].g, s[1].g, s[2].g, s[3].g)));
+    const simd128_t b = unorm8s(simd_add(cb, simd_ld<simd128_t>(s[0].b, s[1].b, s[2].b, s[3].b)));
+    const simd128_t nx = snorm16s(simd_ld<simd128_t>(s[0].normal_x, s[1].normal_x, s[2].normal_x, s[3].normal_x));
+    const simd128_t ny = snorm16s(simd_ld<simd128_t>(s[0].normal_y, s[1].normal_y, s[2].normal_y, s[3].normal_y));
+    const simd128_t nz = snorm16s(simd_ld<simd128_t>(s[0].normal_z, s[1].normal_z, s[2].normal_z, s[3].normal_z));
+    const simd128_t tx = snorm16s(simd_ld<simd128_t>(s[0].texcoord_x1, s[1].texcoord_x1, s[2].texcoord_x1, s[3].texcoord_x1));
+    const simd128_t ty = snorm16s(simd_ld<simd128_t>(s[0].texcoord_y1, s[1].texcoord_y1, s[2].texcoord_y1, s[3].texcoord_y1));
+
+    // pad0 and pad1 zero
+    const simd128_t w0 = simd_or(x, simd_sll(y, 16));
+    const simd128_t w1 = z;
+    const simd128_t w2 = simd_or(simd_or(r, simd_sll(g, 8)), simd_or(simd_sll(b, 16), alpha));
+    const simd128_t w3 = simd_or(nx, simd_sll(ny, 16));
+    const simd128_t w4 = nz;
+    const simd128_t w5 = simd_or(tx, simd_sll(ty, 16));
+
+    // transposed to a vertex per vector, the first four words of each and
+    // their last two in pairs
+    const simd128_t w01_lo = simd_shuf_xAyB(w0, w1);
+    const simd128_t w23_lo = simd_shuf_xAyB(w2, w3);
+    const simd128_t w01_hi = simd_shuf_zCwD(w0, w1);
+    const simd128_t w23_hi = simd_shuf_zCwD(w2, w3);
+    const simd128_t v0 = simd_shuf_xyAB(w01_lo, w23_lo);
+    const simd128_t v1 = simd_shuf_zwCD(w01_lo, w23_lo);
+    const simd128_t v2 = simd_shuf_xyAB(w01_hi, w23_hi);
+    const simd128_t v3 = simd_shuf_zwCD(w01_hi, w23_hi);
+    const simd128_t w45_lo = simd_shuf_xAyB(w4, w5);
+    const simd128_t w45_hi = simd_shuf_zCwD(w4, w5);
+
+    simd_st(&packed[0], v0);
+    simd_st(&packed[4], simd_shuf_xyAB(w45_lo, v1));
+    simd_st(&packed[8], simd_shuf_zwCD(v1, w45_lo));
+    simd_st(&packed[12], v2);
+    simd_st(&packed[16], simd_shuf_xyAB(w45_hi, v3));
+    simd_st(&packed[20], simd_shuf_zwCD(v3, w45_hi));
+    memcpy(&dst[i], packed, sizeof(packed));
+  }
+#endif
+
+  expandModelScalar(&dst[i], &src[i], count - i, pos, col);
+}
+
+
+void BufferObject::writeAnimatedModel
+(const int object, const int offset, const int indices_offset,
+ const bx::Vec3 pos1, const bx::Vec3 pos2,
  const bx::Vec3 col1, const bx::Vec3 col2,
  const int nth1, const int nth2, const bx::Vec3 from, const bx::Vec3 to)
 {
+  if (object >= (int)animation_records.size()) {
+    animation_records.resize(object + 1);
+  }
+  animated_objects_count = object + 1;
+
+  AnimationRecord& r = animation_records[object];
+  r.pos1[0] = pos1.x; r.pos1[1] = pos1.y; r.pos1[2] = pos1.z; r.pos1[3] = from.z;
+  r.pos2[0] = pos2.x; r.pos2[1] = pos2.y; r.pos2[2] = pos2.z; r.pos2[3] = to.z;
+  r.col1[0] = col1.x; r.col1[1] = col1.y; r.col1[2] = col1.z; r.col1[3] = from.y;
+  r.col2[0] = col2.x; r.col2[1] = col2.y; r.col2[2] = col2.z; r.col2[3] = to.y;
+
   int nth_model_vertices_count = models.nth_model_vertices_count(nth1);
+  models_vertices_count = nth_model_vertices_count + offset;
+  models_indices_count = models.nth_model_indices_count(nth1) + indices_offset;
+
+  // the mesh only changes with the model or where it sits in the buffer
+  AnimatedMesh mesh = {offset, indices_offset, nth1, nth2, from.x, to.x};
+  if (object >= (int)animated_meshes.size()) {
+    animated_meshes.resize(object + 1, AnimatedMesh{-1, -1, -1, -1, 0.0f, 0.0f});
+  }
+  if (memcmp(&animated_meshes[object], &mesh, sizeof(mesh)) == 0) {
+    return;
+  }
+  animated_meshes[object] = mesh;
+
+  const PosColorTexVertex* model1 = &models.vertices[models.vertices_offsets[nth1]];
+  const PosColorTexVertex* model2 = &models.vertices[models.vertices_offsets[nth2]];
+  markVertices(offset, nth_model_vertices_count);
+  expandModel(&vertices[offset], model1, nth_model_vertices_count, bx::Vec3(0.0f, 0.0f, 0.0f), bx::Vec3(0.0f, 0.0f, 0.0f));
 
   for (int i = 0; i < nth_model_vertices_count; ++i) {
-    vertices[offset + i].x = models.vertices[models.vertices_offsets[nth1] + i].x;
-    vertices[offset + i].y = models.vertices[models.vertices_offsets[nth1] + i].y;
-    vertices[offset + i].z = models.vertices[models.vertices_offsets[nth1] + i].z;
-    vertices[offset + i].r = col1.x + models.vertices[models.vertices_offsets[nth1] + i].r;
-    vertices[offset + i].g = col1.y + models.vertices[models.vertices_offsets[nth1] + i].g;
-    vertices[offset + i].b = col1.z + models.vertices[models.vertices_offsets[nth1] + i].b;
-    vertices[offset + i].normal_x = models.vertices[models.vertices_offsets[nth1] + i].normal_x;
-    vertices[offset + i].normal_y = models.vertices[models.vertices_offsets[nth1] + i].normal_y;
-    vertices[offset + i].normal_z = models.vertices[models.vertices_offsets[nth1] + i].normal_z;
-
-    vertices[offset + i].x2 = models.vertices[models.vertices_offsets[nth2] + i].x;
-    vertices[offset + i].y2 = models.vertices[models.vertices_offsets[nth2] + i].y;
-    vertices[offset + i].z2 = models.vertices[models.vertices_offsets[nth2] + i].z;
-    vertices[offset + i].r = col2.x + models.vertices[models.vertices_offsets[nth1] + i].r;
-    vertices[offset + i].g = col2.y + models.vertices[models.vertices_offsets[nth1] + i].g;
-    vertices[offset + i].b = col2.z + models.vertices[models.vertices_offsets[nth1] + i].b;
-    vertices[offset + i].normal_x2 = models.vertices[models.vertices_offsets[nth2] + i].normal_x;
-    vertices[offset + i].normal_y2 = models.vertices[models.vertices_offsets[nth2] + i].normal_y;
-    vertices[offset + i].normal_z2 = models.vertices[models.vertices_offsets[nth2] + i].normal_z;
-
-    vertices[offset + i].pos_x1 = pos1.x;
-    vertices[offset + i].pos_y1 = pos1.y;
-    vertices[offset + i].pos_z1 = pos1.z;
-
-    vertices[offset + i].pos_x2 = pos2.x;
-    vertices[offset + i].pos_y2 = pos2.y;
-    vertices[offset + i].pos_z2 = pos2.z;
-
-    vertices[offset + i].pos_from = from.z;
-    vertices[offset + i].pos_to = to.z;
-
-    vertices[offset + i].color_from = from.y;
-    vertices[offset + i].color_to = to.y;
-
-    vertices[offset + i].model_from = from.x;
-    vertices[offset + i].model_to = to.x;
-
-    vertices[offset + i].texcoord_x1 = models.vertices[models.vertices_offsets[nth1] + i].texcoord_x1;
-    vertices[offset + i].texcoord_y1 = models.vertices[models.vertices_offsets[nth1] + i].texcoord_y1;
-
-    vertices[offset + i].texcoord_x2 = models.vertices[models.vertices_offsets[nth2] + i].texcoord_x1;
-    vertices[offset + i].texcoord_y2 = models.vertices[models.vertices_offsets[nth2] + i].texcoord_y1;
+    animations[offset + i].x2 = model2[i].x;
+    animations[offset + i].y2 = model2[i].y;
+    animations[offset + i].z2 = model2[i].z;
+    animations[offset + i].normal_x2 = model2[i].normal_x;
+    animations[offset + i].normal_y2 = model2[i].normal_y;
+    animations[offset + i].normal_z2 = model2[i].normal_z;
+
+    animations[offset + i].model_from = from.x;
+    animations[offset + i].model_to = to.x;
+    animations[offset + i].object = object % max_animated_objects;
+
+    animations[offset + i].texcoord_x2 = model2[i].texcoord_x1;
+    animations[offset + i].texcoord_y2 = model2[i].texcoord_y1;
   }
 
-  // if (nth_model_vertices_count + offset > models_vertices_count) {
-  models_vertices_count = nth_model_vertices_count + offset;
+  writeModelIndices(indices_offset, offset, nth1);
 }
 
 
@@ -352,9 +645,10 @@ void BufferObject::writeModelIndices
 (const int offset, const int vertices_num_offset, const int nth)
 {
   int nth_model_indices_count = models.nth_model_indices_count(nth);
+  markIndices(offset, nth_model_indices_count);
 
   for (int i = 0; i < nth_model_indices_count; ++i) {
-    indices[offset + i] = vertices_num_offset + models.indices[models.indices_offsets[nth] + i];
+    setIndex(offset + i, vertices_num_offset + models.indices[models.indices_offsets[nth] + i]);
   }
 
   // if (nth_model_indices_count + offset > models_indices_count) {
@@ -367,8 +661,8 @@ void BufferObject::initQuads(const int quads_count)
   vertices_count = quads_count * 4;
   indices_count = quads_count * 6;
 
-  vertices = new AnimatedPosColorTexVertex[vertices_count];
-  indices = new uint16_t[indices_count];
+  vertices = Arena::run().alloc<PackedPosColorTexVertex>(vertices_count);
+  allocIndices();
 
   writeQuadsIndices();
 }
@@ -376,110 +670,82 @@ void BufferObject::initQuads(const int quads_count)
 
 void BufferObject::writeQuadsIndices()
 {
+  markIndices(0, indices_count);
+
   for (int i = 0; i < indices_count / 6; ++i) {
     // x4 y4 -- x2 y2
     //   |        |
     //   |        |
     // x3 y3 -- x1 y1
     //
-    indices[i * 6 + 0] = i * 4 + 1;
-    indices[i * 6 + 1] = i * 4 + 0;
-    indices[i * 6 + 2] = i * 4 + 3;
-    indices[i * 6 + 3] = i * 4 + 0;
-    indices[i * 6 + 4] = i * 4 + 2;
-    indices[i * 6 + 5] = i * 4 + 3;
+    setIndex(i * 6 + 0, i * 4 + 1);
+    setIndex(i * 6 + 1, i * 4 + 0);
+    setIndex(i * 6 + 2, i * 4 + 3);
+    setIndex(i * 6 + 3, i * 4 + 0);
+    setIndex(i * 6 + 4, i * 4 + 2);
+    setIndex(i * 6 + 5, i * 4 + 3);
+  }
+}
+
+
+// a quad lying flat along an axis, as tiles and the screen quads do, has
+// two components of the cross exactly 0 and its normal is the third axis,
+// no square root needed
+static bx::Vec3 quadNormal(const bx::Vec3& a, const bx::Vec3& b, const bx::Vec3& c)
+{
+  bx::Vec3 n = bx::cross(bx::sub(a, b), bx::sub(a, c));
+
+  if (n.x == 0.0f && n.y == 0.0f) {
+    return bx::Vec3(0.0f, 0.0f, n.z < 0.0f ? -1.0f : 1.0f);
+  }
+  if (n.x == 0.0f && n.z == 0.0f) {
+    return bx::Vec3(0.0f, n.y < 0.0f ? -1.0f : 1.0f, 0.0f);
+  }
+  if (n.y == 0.0f && n.z == 0.0f) {
+    return bx::Vec3(n.x < 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f);
   }
+
+  return bx::normalize(n);
 }
 
 
 void BufferObject::writeQuadsVertices
-(const int offset, const std::vector<bx::Vec3>& vs, const std::vector<bx::Vec3>cs, const std::vector<int>& mapping_ids)
-{
-  for (int i = 0; i < vs.size(); ++i) {
-    vertices[offset + i].x = vs[i].x;
-    vertices[offset + i].y = vs[i].y;
-    vertices[offset + i].z = vs[i].z;
-    vertices[offset + i].r = cs[i].x;
-    vertices[offset + i].g = cs[i].y;
-    vertices[offset + i].b = cs[i].z;
-
-    vertices[offset + i].pos_x1 = 0.0f;
-    vertices[offset + i].pos_y1 = 0.0f;
-    vertices[offset + i].pos_z1 = 0.0f;
-  }
-
-  for(int i = 0; i < vs.size(); i += 4) {
-    a = bx::Vec3(
-        vertices[offset + i + 1].x,
-        vertices[offset + i + 1].y,
-        vertices[offset + i + 1].z
-        );
-    b = bx::Vec3(
-        vertices[offset + i + 0].x,
-        vertices[offset + i + 0].y,
-        vertices[offset + i + 0].z
-        );
-    c = bx::Vec3(
-        vertices[offset + i + 3].x,
-        vertices[offset + i + 3].y,
-        vertices[offset + i + 3].z
-        );
-
-    normal = bx::normalize(
-        bx::cross(
-          bx::sub(a, b),
-          bx::sub(a, c)
-          )
-        );
-
-    vertices[offset + i + 0].normal_x =
-      vertices[offset + i + 1].normal_x =
-      vertices[offset + i + 2].normal_x =
-      vertices[offset + i + 3].normal_x =
-      normal.x;
-
-    vertices[offset + i + 0].normal_y =
-      vertices[offset + i + 1].normal_y =
-      vertices[offset + i + 2].normal_y =
-      vertices[offset + i + 3].normal_y =
-      normal.y;
-
-    vertices[offset + i + 0].normal_z =
-      vertices[offset + i + 1].normal_z =
-      vertices[offset + i + 2].normal_z =
-      vertices[offset + i + 3].normal_z =
-      normal.z;
+(const int offset, const bx::Vec3* vs, const bx::Vec3* cs, const int count, const std::vector<int>& mapping_ids)
+{
+  markVertices(offset, count);
+
+  for (int i = 0; i < count; ++i) {
+    vertices[offset + i].setPosition(vs[i].x, vs[i].y, vs[i].z);
+    vertices[offset + i].setColor(cs[i].x, cs[i].y, cs[i].z);
+  }
+
+  for(int i = 0; i < count; i += 4) {
+    normal = quadNormal(vs[i + 1], vs[i + 0], vs[i + 3]);
+
+    vertices[offset + i + 0].setNormal(normal.x, normal.y, normal.z);
+    vertices[offset + i + 1].setNormal(normal.x, normal.y, normal.z);
+    vertices[offset + i + 2].setNormal(normal.x, normal.y, normal.z);
+    vertices[offset + i + 3].setNormal(normal.x, normal.y, normal.z);
   // }
 
   // for (int i = 0; i < mapping_ids.size(); ++i) {
     mapping_id = mapping_ids[i / 4];
     if (mapping_id == -1) {
-      vertices[offset + i + 0].texcoord_x1 = -1.0f;
-      vertices[offset + i + 0].texcoord_y1 = -1.0f;
-      vertices[offset + i + 1].texcoord_x1 = -1.0f;
-      vertices[offset + i + 1].texcoord_y1 = -1.0f;
-      vertices[offset + i + 2].texcoord_x1 = -1.0f;
-      vertices[offset + i + 2].texcoord_y1 = -1.0f;
-      vertices[offset + i + 3].texcoord_x1 = -1.0f;
-      vertices[offset + i + 3].texcoord_y1 = -1.0f;
+      vertices[offset + i + 0].setTexcoord(-1.0f, -1.0f);
+      vertices[offset + i + 1].setTexcoord(-1.0f, -1.0f);
+      vertices[offset + i + 2].setTexcoord(-1.0f, -1.0f);
+      vertices[offset + i + 3].setTexcoord(-1.0f, -1.0f);
     } else if (mapping_id == -2) {
-      vertices[offset + i + 0].texcoord_x1 = 1.0f;
-      vertices[offset + i + 0].texcoord_y1 = 1.0f;
-      vertices[offset + i + 1].texcoord_x1 = 1.0f;
-      vertices[offset + i + 1].texcoord_y1 = 0.0f;
-      vertices[offset + i + 2].texcoord_x1 = 0.0f;
-      vertices[offset + i + 2].texcoord_y1 = 1.0f;
-      vertices[offset + i + 3].texcoord_x1 = 0.0f;
-      vertices[offset + i + 3].texcoord_y1 = 0.0f;
+      vertices[offset + i + 0].setTexcoord(1.0f, 1.0f);
+      vertices[offset + i + 1].setTexcoord(1.0f, 0.0f);
+      vertices[offset + i + 2].setTexcoord(0.0f, 1.0f);
+      vertices[offset + i + 3].setTexcoord(0.0f, 0.0f);
     } else {
-      vertices[offset + i + 0].texcoord_x1 = textures.mappings[mapping_id].x2;
-      vertices[offset + i + 0].texcoord_y1 = textures.mappings[mapping_id].y1;
-      vertices[offset + i + 1].texcoord_x1 = textures.mappings[mapping_id].x2;
-      vertices[offset + i + 1].texcoord_y1 = textures.mappings[mapping_id].y2;
-      vertices[offset + i + 2].texcoord_x1 = textures.mappings[mapping_id].x1;
-      vertices[offset + i + 2].texcoord_y1 = textures.mappings[mapping_id].y1;
-      vertices[offset + i + 3].texcoord_x1 = textures.mappings[mapping_id].x1;
-      vertices[offset + i + 3].texcoord_y1 = textures.mappings[mapping_id].y2;
+      const Textures::Mapping& mapping = textures.mappings[mapping_id];
+      vertices[offset + i + 0].setTexcoord(mapping.x2, mapping.y1);
+      vertices[offset + i + 1].setTexcoord(mapping.x2, mapping.y2);
+      vertices[offset + i + 2].setTexcoord(mapping.x1, mapping.y1);
+      vertices[offset + i + 3].setTexcoord(mapping.x1, mapping.y2);
     }
   }
 }
@@ -489,3 +755,74 @@ void BufferObject::drawQuads(bgfx::ViewId view, uint16_t current_quads_count, ui
 {
   draw(view, current_quads_count * 4, current_quads_count * 6, more_state);
 }
+
+
+void BufferObject::initInstanced(const int instances_count)
+{
+  instanced = true;
+
+  // room for every mesh once, however many models get placed
+  vertices_count = models.vertices_count;
+  indices_count = models.indices_count;
+
+  vertices = Arena::run().alloc<PackedPosColorTexVertex>(vertices_count);
+  allocIndices();
+
+  instances.reserve(instances_count);
+}
+
+
+void BufferObject::writeMeshes()
+{
+  bx::Vec3 zero(0.0f, 0.0f, 0.0f);
+
+  for (int nth = 0; nth < models.models_count; ++nth) {
+    writeModelVertices(models.vertices_offsets[nth], zero, zero, nth);
+    writeModelIndices(models.indices_offsets[nth], 0, nth);
+  }
+
+  instances_offsets.resize(models.models_count);
+  instances_counts.resize(models.models_count);
+  instances_cursors.resize(models.models_count);
+}
+
+
+void BufferObject::writeInstances
+(const std::vector<bx::Vec3>& positions, const std::vector<bx::Vec3>& colors, const std::vector<int>& models_list)
+{
+  // counting sort by model, ids without a mesh are dropped
+  for (int nth = 0; nth < models.models_count; ++nth) {
+    instances_counts[nth] = 0;
+  }
+
+  for (int i = 0; i < (int)positions.size(); ++i) {
+    if (models_list[i] < models.models_count) {
+      instances_counts[models_list[i]] += 1;
+    }
+  }
+
+  int acc_offset = 0;
+  for (int nth = 0; nth < models.models_count; ++nth) {
+    instances_offsets[nth] = instances_cursors[nth] = acc_offset;
+    acc_offset += instances_counts[nth];
+  }
+
+  instances.resize(acc_offset);
+
+  for (int i = 0; i < (int)positions.size(); ++i) {
+    int nth = models_list[i];
+    if (nth >= models.models_count) {
+      continue;
+    }
+
+    InstanceData& instance = instances[instances_cursors[nth]++];
+    instance.x = positions[i].x;
+    instance.y = positions[i].y;
+    instance.z = positions[i].z;
+    instance.model = nth;
+    instance.r = colors[i].x;
+    instance.g = colors[i].y;
+    instance.b = colors[i].z;
+    instance.a = 0.0f;
+  }
+}
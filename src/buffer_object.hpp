@@ -19,6 +19,20 @@ static const int vertices_per_cube_count = faces_per_cube_count * vertices_per_f
 static const int indices_per_face_count = 6;
 static const int indices_per_cube_count = indices_per_face_count * faces_per_cube_count;
 
+static const uint64_t draw_state = 0
+  | BGFX_STATE_WRITE_R
+  | BGFX_STATE_WRITE_G
+  | BGFX_STATE_WRITE_B
+  | BGFX_STATE_WRITE_A
+  | BGFX_STATE_WRITE_Z
+  | BGFX_STATE_DEPTH_TEST_LESS
+  | BGFX_STATE_CULL_CCW
+  | BGFX_STATE_MSAA;
+
+// placed models an animated buffer moves from the shaders per draw, the
+// size of their animation uniform. Buffers with more draw in groups
+static const int max_animated_objects = 16;
+
 static const int vertices_per_lines_face_count = 4;
 static const int vertices_per_lines_cube_count = faces_per_cube_count * vertices_per_lines_face_count;
 static const int indices_per_lines_face_count = 6;
@@ -64,6 +78,16 @@ static const bx::Vec3 constexpr pos_vertices[vertices_per_cube_count] = {
   {  1.0f, -1.0f,  1.0f,},
 };
 
+// one per face of pos_vertices, what the cross of their corners gives
+static const bx::Vec3 constexpr cube_normals[faces_per_cube_count] = {
+  {  0.0f,  0.0f, -1.0f,}, // front
+  {  1.0f,  0.0f,  0.0f,}, // right
+  {  0.0f,  0.0f,  1.0f,}, // back
+  { -1.0f,  0.0f,  0.0f,}, // left
+  {  0.0f,  1.0f,  0.0f,}, // top
+  {  0.0f, -1.0f,  0.0f,}, // bottom
+};
+
 static const bx::Vec3 constexpr pos_lines_vertices[vertices_per_cube_count] = {
   // CCW culling, indices: 0, 1, 3, 1, 2, 3, means: 'u' shapes starting on the right
 
@@ -105,14 +129,73 @@ static const bx::Vec3 constexpr pos_lines_vertices[vertices_per_cube_count] = {
 };
 
 
+// per placed model on the instanced path, read as i_data0 and i_data1
+struct InstanceData {
+  float x, y, z, model;
+  float r, g, b, a;
+
+  // only the stride matters, for instances kept in a vertex buffer
+  static void init() {
+    ms_layout
+      .begin()
+      .add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+      .add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
+      .end();
+  };
+
+  static bgfx::VertexLayout ms_layout;
+};
+
+
 struct BufferObject {
+  // [from, to) in vertices or indices
+  struct Span {
+    int from;
+    int to;
+  };
+
+  // per placed model of an animated buffer, four vec4s for the shaders:
+  // both placements and both colours, each with its time in w
+  struct AnimationRecord {
+    float pos1[4];
+    float pos2[4];
+    float col1[4];
+    float col2[4];
+  };
+
+  // max_animated_objects placed models drawn together, their indices and
+  // the records the shaders index within the group
+  struct AnimationGroup {
+    uint32_t first_index;
+    uint32_t indices_count;
+    const AnimationRecord* records;
+    uint16_t records_num;
+  };
+
+  // what an animated model's vertices were last written for
+  struct AnimatedMesh {
+    int offset;
+    int indices_offset;
+    int nth1;
+    int nth2;
+    float model_from;
+    float model_to;
+  };
+
   int vertices_count;
   int indices_count;
 
-  AnimatedPosColorTexVertex* vertices;
-  uint16_t* indices;
+  PackedPosColorTexVertex* vertices;
+  // 16 bit indices unless the buffer holds more vertices than they reach,
+  // only the one matching index32 is allocated
+  bool index32 = false;
+  uint16_t* indices = NULL;
+  uint32_t* indices32 = NULL;
+  // second vertex stream, only allocated for animated buffers
+  AnimationVertex* animations = NULL;
 
   bgfx::DynamicVertexBufferHandle m_vbh;
+  bgfx::DynamicVertexBufferHandle m_abh = BGFX_INVALID_HANDLE;
   bgfx::DynamicIndexBufferHandle m_ibh;
   bgfx::ProgramHandle m_program;
 
@@ -123,33 +206,93 @@ struct BufferObject {
   void initCubes(const int cubes_count);
   void initCubesLines(const int cubes_count);
   void initModels(const int models_count);
+  void initAnimatedModels(const int models_count);
   void initQuads(const int quads_count);
+  void initInstanced(const int instances_count);
+  void allocIndices();
+  const void* indexData(const int from) const;
+  int indexSize() const;
+  void setIndex(const int i, const uint32_t value)
+  {
+    if (index32) {
+      indices32[i] = value;
+    } else {
+      indices[i] = value;
+    }
+  }
   void writeCubesIndices();
   void writeCubesLinesIndices();
   void writeCubeVertices(const int nth_cube, bx::Vec3 pos, bx::Vec3 col);
   void writeCubeLinesVertices(const int nth_cube, bx::Vec3 pos, bx::Vec3 col);
   void writeModelVertices(const int offset, bx::Vec3 pos, bx::Vec3 col, const int nth);
-  void writeModelVertices
-    (const int offset, const bx::Vec3 pos1, const bx::Vec3 pos2,
+  void writeAnimatedModel
+    (const int object, const int offset, const int indices_offset,
+     const bx::Vec3 pos1, const bx::Vec3 pos2,
      const bx::Vec3 col1, const bx::Vec3 col2,
      const int nth1, const int nth2, const bx::Vec3 from, const bx::Vec3 to);
   void writeModelIndices(const int offset, const int vertices_num_offset, const int nth);
-  void writeQuadsVertices(const int offset, const std::vector<bx::Vec3>& vs, const std::vector<bx::Vec3>cs, const std::vector<int>& mapping_ids);
+  void writeQuadsVertices(const int offset, const bx::Vec3* vs, const bx::Vec3* cs, const int count, const std::vector<int>& mapping_ids);
   void writeQuadsIndices();
+  void writeMeshes();
+  void writeInstances(const std::vector<bx::Vec3>& positions, const std::vector<bx::Vec3>& colors, const std::vector<int>& models_list);
   void setFaceColor(const int nth_cube, const int nth_face, bx::Vec3 col);
   void createBuffers();
   void updateBuffer();
+  bool allocTransient(const uint32_t current_vertices_count, const uint32_t current_indices_count);
+  void markVertices(const int from, const int count);
+  void markIndices(const int from, const int count);
+  static void mark(std::vector<Span>& spans, const int from, const int to);
+  static void merge(std::vector<Span>& spans, const int capacity);
+  // a model's mesh into packed vertices, moved by pos and tinted by col,
+  // four vertices at a time with bx's simd in optimised builds where there
+  // is one. The scalar one writes the same bytes and takes what is left
+  // past a multiple of 4
+  static void expandModel(PackedPosColorTexVertex* dst, const PosColorTexVertex* src, const int count, const bx::Vec3 pos, const bx::Vec3 col);
+  static void expandModelScalar(PackedPosColorTexVertex* dst, const PosColorTexVertex* src, const int count, const bx::Vec3 pos, const bx::Vec3 col);
+  // whether expandModel was built with its simd kernel
+  static const bool expand_simd;
   void createShaders(const char* vertex_shader_path, const char* fragment_shader_path);
-  void draw(bgfx::ViewId view, uint16_t current_vertices_count, uint16_t current_indices_count, uint64_t more_state);
+  void draw(bgfx::ViewId view, uint32_t current_vertices_count, uint32_t current_indices_count, uint64_t more_state);
+  void draw(bgfx::Encoder* encoder, bgfx::ViewId view, uint32_t current_vertices_count, uint32_t current_indices_count, uint64_t more_state = 0);
   void drawCubes(bgfx::ViewId view, uint16_t current_cubes_count, uint64_t more_state = 0);
   void drawCubesLines(bgfx::ViewId view, uint16_t current_cubes_count);
-  void drawModels(bgfx::ViewId view, uint64_t more_state);
   void drawQuads(bgfx::ViewId view, uint16_t current_quads_count, uint64_t more_state = 0);
+  int animationGroupsCount() const;
+  AnimationGroup animationGroup(const int group, const uint32_t current_indices_count) const;
   void destroy();
 
   int models_vertices_count = 0;
   int models_indices_count = 0;
 
+  // written since the last upload, updateBuffer sends only these
+  std::vector<Span> dirty_vertices;
+  std::vector<Span> dirty_indices;
+
+  // instanced buffers hold one copy of each mesh, every placed model is an
+  // instance, kept grouped by model so each model is a single draw
+  bool instanced = false;
+  std::vector<InstanceData> instances;
+  std::vector<int> instances_offsets;
+  std::vector<int> instances_counts;
+  std::vector<int> instances_cursors;
+
+  // animated buffers keep placements and colours out of the vertices, a
+  // scheduled move rewrites one record and only a new model its vertices.
+  // Every model has its own record, drawn max_animated_objects at a time
+  std::vector<AnimationRecord> animation_records;
+  std::vector<AnimatedMesh> animated_meshes;
+  int animated_objects_count = 0;
+  bgfx::UniformHandle u_animation = BGFX_INVALID_HANDLE;
+
+  // transient buffers get no dynamic ones and upload nothing, each draw
+  // copies what is used into bgfx's per frame buffers. Set before
+  // createBuffers, which keeps buffers past 16 bit indices or instanced
+  // ones dynamic as bgfx's transient indices are 16 bit
+  bool transient = false;
+  bgfx::TransientVertexBuffer m_tvb;
+  bgfx::TransientVertexBuffer m_tab;
+  bgfx::TransientIndexBuffer m_tib;
+
   int offset, mapping_id;
   bx::Vec3 end_pos, normal, a, b, c;
 };
@@ -0,0 +1,50 @@
+#include "chunking.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+void Chunking::sort
+(const std::vector<bx::Vec3>& from_positions, const std::vector<bx::Vec3>& from_colors, const std::vector<int>& from_models_list)
+{
+  int count = from_positions.size();
+
+  keys.resize(count);
+  order.resize(count);
+  for (int i = 0; i < count; ++i) {
+    int cx = (int)std::floor(from_positions[i].x / chunk_size);
+    int cz = (int)std::floor(from_positions[i].z / chunk_size);
+    keys[i] = cx * 65536 + cz;
+    order[i] = i;
+  }
+
+  // stable by hand, std::stable_sort allocates its buffer on every call
+  std::sort(order.begin(), order.end(), [this](const int a, const int b) {
+    return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+  });
+
+  positions.resize(count);
+  colors.resize(count);
+  models_list.resize(count);
+  chunks.clear();
+
+  for (int i = 0; i < count; ++i) {
+    int o = order[i];
+    const bx::Vec3& p = from_positions[o];
+
+    positions[i] = p;
+    colors[i] = from_colors[o];
+    models_list[i] = from_models_list[o];
+
+    if (i == 0 || keys[o] != keys[order[i - 1]]) {
+      Chunk chunk = {i, i, {p.x, min_y, p.z}, {p.x, max_y, p.z}};
+      chunks.push_back(chunk);
+    }
+
+    Chunk& chunk = chunks.back();
+    chunk.to = i + 1;
+    chunk.min[0] = bx::min(chunk.min[0], p.x - object_reach);
+    chunk.min[2] = bx::min(chunk.min[2], p.z - object_reach);
+    chunk.max[0] = bx::max(chunk.max[0], p.x + object_reach);
+    chunk.max[2] = bx::max(chunk.max[2], p.z + object_reach);
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef CHUNKING
+#define CHUNKING
+#pragma once
+
+#include <vector>
+#include <bx/math.h>
+
+// A static layer's objects sorted by the square of the grid they sit in,
+// so each chunk is one contiguous run of objects with its own bounds and
+// draws on its own. The layer is written from the sorted copies; the
+// order within a chunk is kept.
+struct Chunking
+{
+  // 8 spots a side, spots are 2 apart
+  static constexpr float chunk_size = 16.0f;
+  // how far a model reaches from its position, floor gradients included
+  static constexpr float object_reach = 2.0f;
+  static constexpr float min_y = -3.0f;
+  static constexpr float max_y = 3.0f;
+
+  struct Chunk
+  {
+    int from;
+    int to;
+    float min[3];
+    float max[3];
+  };
+
+  std::vector<Chunk> chunks;
+  std::vector<bx::Vec3> positions;
+  std::vector<bx::Vec3> colors;
+  std::vector<int> models_list;
+
+  void sort(const std::vector<bx::Vec3>& from_positions, const std::vector<bx::Vec3>& from_colors, const std::vector<int>& from_models_list);
+
+  std::vector<int> keys;
+  std::vector<int> order;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "common.hpp"
+#include "arena.hpp"
 
 void Common::pv3(bx::Vec3 v)
 {
@@ -7,7 +8,6 @@ void Common::pv3(bx::Vec3 v)
 
 bgfx::ShaderHandle Common::loadShader(const char* _name)
 {
-  char* data = new char[2048];
   std::ifstream file;
   size_t fileSize;
   file.open(_name);
@@ -16,6 +16,10 @@ bgfx::ShaderHandle Common::loadShader(const char* _name)
   file.seekg(0, std::ios::end);
   fileSize = file.tellg();
   file.seekg(0, std::ios::beg);
+
+  // staging sized to the file, shaders outgrew a fixed 2 KB
+  Arena::Scope scope(Arena::run());
+  char* data = Arena::run().alloc<char>(fileSize + 1);
   file.read(data, fileSize);
   file.close();
 
@@ -20,12 +20,12 @@ void Editor::add(std::vector<Spot>& spots, const Spot& spot, BufferObject& bo, s
 
 void Editor::remove(const Spot& spot)
 {
-  if (remove_for(world->moving_spots, world->moving_models_list, spot) ||
-      remove_for(world->static_spots, world->static_models_list, spot) ||
-      remove_for(world->doors_spots, world->doors_models_list, spot) ||
-      remove_for(world->winning_doors_spots, world->winning_doors_models_list, spot) ||
-      remove_for(world->tiles_spots, spot) ||
-      remove_for(world->floor_spots, world->floor_models_list, spot)
+  if (remove_for(world->state.moving_spots, world->moving_models_list, spot) ||
+      remove_for(world->state.static_spots, world->state.static_models_list, spot) ||
+      remove_door(spot) ||
+      remove_for(world->state.winning_doors_spots, world->winning_doors_models_list, spot) ||
+      remove_for(world->state.tiles_spots, spot) ||
+      remove_for(world->state.floor_spots, world->state.floor_models_list, spot)
       ) {
     world->init();
     world->updateBuffers();
@@ -33,6 +33,27 @@ void Editor::remove(const Spot& spot)
 }
 
 
+void Editor::addDoor(const Spot& spot)
+{
+  world->state.addDoor(spot);
+  world->init();
+  world->doors_bo.updateBuffer();
+}
+
+
+bool Editor::remove_door(const Spot& spot)
+{
+  id = find(world->state.doors_spots, spot);
+  if (id != -1) {
+    world->state.removeDoor(id);
+    world->doors_models_list.erase(world->doors_models_list.begin() + id);
+    return true;
+  }
+
+  return false;
+}
+
+
 int Editor::find(const std::vector<Spot>& spots, const Spot& spot)
 {
   fr(i, spots) {
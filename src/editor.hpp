@@ -17,6 +17,8 @@ struct Editor
   void add(std::vector<Spot>& spots, const Spot& spot, BufferObject& bo);
   void add(std::vector<Spot>& spots, const Spot& spot, BufferObject& bo, std::vector<int>& list, int id);
   void remove(const Spot& spot);
+  void addDoor(const Spot& spot);
+  bool remove_door(const Spot& spot);
 
   int find(const std::vector<Spot>& spots, const Spot& spot);
   bool remove_for(std::vector<Spot>& spots, const Spot& spot);
@@ -0,0 +1,89 @@
+#include "frustum.hpp"
+#include <bx/simd_t.h>
+
+
+void Frustum::Boxes::clear()
+{
+  groups.clear();
+  count = 0;
+}
+
+
+void Frustum::Boxes::add(const float* min, const float* max)
+{
+  int lane = count % 4;
+  if (lane == 0) {
+    // unused lanes stay empty boxes at the origin
+    groups.push_back(Boxes4());
+    bx::memSet(&groups.back(), 0, sizeof(Boxes4));
+  }
+
+  Boxes4& group = groups.back();
+  group.cx[lane] = (min[0] + max[0]) * 0.5f;
+  group.cy[lane] = (min[1] + max[1]) * 0.5f;
+  group.cz[lane] = (min[2] + max[2]) * 0.5f;
+  group.ex[lane] = (max[0] - min[0]) * 0.5f;
+  group.ey[lane] = (max[1] - min[1]) * 0.5f;
+  group.ez[lane] = (max[2] - min[2]) * 0.5f;
+
+  count += 1;
+}
+
+
+void Frustum::build(const float* view_proj)
+{
+  // bx multiplies row vectors, clip space x is column 0 and so on
+  for (int i = 0; i < 4; ++i) {
+    float x = view_proj[i * 4 + 0];
+    float y = view_proj[i * 4 + 1];
+    float z = view_proj[i * 4 + 2];
+    float w = view_proj[i * 4 + 3];
+
+    planes[0][i] = w + x;
+    planes[1][i] = w - x;
+    planes[2][i] = w + y;
+    planes[3][i] = w - y;
+    // the [-1, 1] near plane, looser than [0, 1] depth needs
+    planes[4][i] = w + z;
+    planes[5][i] = w - z;
+  }
+}
+
+
+void Frustum::cull(const Boxes& boxes, std::vector<uint8_t>& visible) const
+{
+  using namespace bx;
+
+  visible.resize(boxes.groups.size() * 4);
+
+  const simd128_t zero = simd_zero<simd128_t>();
+  BX_ALIGN_DECL_16(uint32_t out[4]);
+
+  for (int g = 0; g < (int)boxes.groups.size(); ++g) {
+    const Boxes4& group = boxes.groups[g];
+    const simd128_t cx = simd_ld<simd128_t>(group.cx);
+    const simd128_t cy = simd_ld<simd128_t>(group.cy);
+    const simd128_t cz = simd_ld<simd128_t>(group.cz);
+    const simd128_t ex = simd_ld<simd128_t>(group.ex);
+    const simd128_t ey = simd_ld<simd128_t>(group.ey);
+    const simd128_t ez = simd_ld<simd128_t>(group.ez);
+
+    simd128_t outside = zero;
+    for (int p = 0; p < 6; ++p) {
+      const simd128_t a = simd_splat<simd128_t>(planes[p][0]);
+      const simd128_t b = simd_splat<simd128_t>(planes[p][1]);
+      const simd128_t c = simd_splat<simd128_t>(planes[p][2]);
+      const simd128_t d = simd_splat<simd128_t>(planes[p][3]);
+
+      const simd128_t distance = simd_madd(a, cx, simd_madd(b, cy, simd_madd(c, cz, d)));
+      const simd128_t radius = simd_madd(simd_abs(a), ex, simd_madd(simd_abs(b), ey, simd_mul(simd_abs(c), ez)));
+
+      outside = simd_or(outside, simd_cmplt(simd_add(distance, radius), zero));
+    }
+
+    simd_st(out, outside);
+    for (int lane = 0; lane < 4; ++lane) {
+      visible[g * 4 + lane] = out[lane] == 0;
+    }
+  }
+}
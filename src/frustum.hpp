@@ -0,0 +1,42 @@
+#ifndef FRUSTUM
+#define FRUSTUM
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <bx/math.h>
+
+// The six planes of a view projection, tested against boxes four at a time
+// with bx's simd128, which falls back to plain floats where there is none.
+// Planes are left unnormalised, a box is out when its centre is further
+// behind one plane than its half extents reach.
+struct Frustum
+{
+  // four boxes as centres and half extents, one lane each
+  struct Boxes4
+  {
+    float cx[4];
+    float cy[4];
+    float cz[4];
+    float ex[4];
+    float ey[4];
+    float ez[4];
+  };
+
+  // boxes in groups of four, relies on the allocator's 16 byte alignment
+  struct Boxes
+  {
+    std::vector<Boxes4> groups;
+    int count = 0;
+
+    void clear();
+    void add(const float* min, const float* max);
+  };
+
+  float planes[6][4];
+
+  void build(const float* view_proj);
+  void cull(const Boxes& boxes, std::vector<uint8_t>& visible) const;
+};
+
+#endif
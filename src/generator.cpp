@@ -0,0 +1,150 @@
+#include "generator.hpp"
+#include "hints.hpp"
+
+
+bool Generator::generate(const WorldState& base, uint32_t seed, Candidate& candidate)
+{
+  candidate.state = base;
+  WorldState& state = candidate.state;
+
+  int mutations = 1 + random(seed, max_mutations);
+  for (int i = 0; i < mutations; ++i) {
+    mutate(state, seed);
+  }
+
+  state.init();
+
+  solver.max_states = max_states;
+  candidate.result = solver.solve(state);
+
+  // unsolvable, too big to tell, too easy or too long
+  if (!candidate.result.solvable ||
+      candidate.result.moves < min_moves ||
+      candidate.result.moves > max_moves) {
+    return false;
+  }
+
+  candidate.key = Hints::layoutHash(state) ^ Solver::hash(state.moving_spots);
+
+  return true;
+}
+
+
+void Generator::mutate(WorldState& state, uint32_t& seed)
+{
+  switch (random(seed, 4)) {
+    case 0:
+      addFloor(state, seed);
+      break;
+
+    case 1:
+      removeFloor(state, seed);
+      break;
+
+    case 2:
+      moveSpot(state, state.doors_spots, seed);
+      break;
+
+    case 3:
+      moveSpot(state, state.winning_doors_spots, seed);
+      break;
+  }
+}
+
+
+bool Generator::addFloor(WorldState& state, uint32_t& seed)
+{
+  if (state.floor_spots.empty()) {
+    return false;
+  }
+
+  // grow next to an existing floor so the level stays in one piece
+  const Spot& from = state.floor_spots[random(seed, state.floor_spots.size())];
+  const Spot& direction = directions[random(seed, 4)];
+  Spot spot = {from.x + direction.x, from.y + direction.y};
+
+  if (find(state.floor_spots, spot) != -1 || find(state.static_spots, spot) != -1) {
+    return false;
+  }
+
+  state.floor_spots.push_back(spot);
+  state.floor_models_list.push_back(0);
+
+  return true;
+}
+
+
+bool Generator::removeFloor(WorldState& state, uint32_t& seed)
+{
+  if (state.floor_spots.empty()) {
+    return false;
+  }
+
+  int i = random(seed, state.floor_spots.size());
+  if (occupied(state, state.floor_spots[i])) {
+    return false;
+  }
+
+  state.floor_spots.erase(state.floor_spots.begin() + i);
+  if (i < (int)state.floor_models_list.size()) {
+    state.floor_models_list.erase(state.floor_models_list.begin() + i);
+  }
+
+  return true;
+}
+
+
+bool Generator::moveSpot(WorldState& state, std::vector<Spot>& spots, uint32_t& seed)
+{
+  if (spots.empty()) {
+    return false;
+  }
+
+  findFree(state);
+  if (free_spots.empty()) {
+    return false;
+  }
+
+  spots[random(seed, spots.size())] = free_spots[random(seed, free_spots.size())];
+
+  return true;
+}
+
+
+void Generator::findFree(const WorldState& state)
+{
+  free_spots.clear();
+
+  fr(i, state.floor_spots) {
+    if (!occupied(state, state.floor_spots[i])) {
+      free_spots.push_back(state.floor_spots[i]);
+    }
+  }
+}
+
+
+bool Generator::occupied(const WorldState& state, const Spot& spot)
+{
+  return find(state.moving_spots, spot) != -1 ||
+    find(state.doors_spots, spot) != -1 ||
+    find(state.winning_doors_spots, spot) != -1;
+}
+
+
+int Generator::find(const std::vector<Spot>& spots, const Spot& spot)
+{
+  fr(i, spots) {
+    if (spots[i].x == spot.x && spots[i].y == spot.y) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+
+uint32_t Generator::random(uint32_t& seed, const uint32_t n)
+{
+  seed = seed * 1664525u + 1013904223u;
+  return (seed >> 8) % n;
+}
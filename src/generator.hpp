@@ -0,0 +1,43 @@
+#ifndef GENERATOR
+#define GENERATOR
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "world_state.hpp"
+#include "solver.hpp"
+
+// Mutates a level's floor, doors and goals and keeps the candidates whose
+// optimal solution length lands in [min_moves, max_moves]. One Generator
+// per thread, the solver's tables are reused between candidates.
+struct Generator
+{
+  struct Candidate
+  {
+    WorldState state;
+    Solver::Result result;
+    uint64_t key;
+  };
+
+  int min_moves = 10;
+  int max_moves = 40;
+  int max_mutations = 6;
+  int max_states = 1 << 18;
+
+  Solver solver;
+  std::vector<Spot> free_spots;
+
+  bool generate(const WorldState& base, uint32_t seed, Candidate& candidate);
+  void mutate(WorldState& state, uint32_t& seed);
+
+  bool addFloor(WorldState& state, uint32_t& seed);
+  bool removeFloor(WorldState& state, uint32_t& seed);
+  bool moveSpot(WorldState& state, std::vector<Spot>& spots, uint32_t& seed);
+
+  void findFree(const WorldState& state);
+  static bool occupied(const WorldState& state, const Spot& spot);
+  static int find(const std::vector<Spot>& spots, const Spot& spot);
+  static uint32_t random(uint32_t& seed, const uint32_t n);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "grid.hpp"
+#include <limits.h>
+
+const Grid::Cell Grid::empty_cell = {0, 0, -1, -1};
+
+
+void Grid::build(
+    const std::vector<Spot>& floor_spots,
+    const std::vector<Spot>& static_spots,
+    const std::vector<Spot>& doors_spots,
+    const std::vector<int>& doors_partners,
+    const std::vector<Spot>& winning_doors_spots,
+    const std::vector<Spot>& moving_spots
+    )
+{
+  min_x = INT_MAX;
+  min_y = INT_MAX;
+  max_x = INT_MIN;
+  max_y = INT_MIN;
+
+  fit(floor_spots);
+  fit(static_spots);
+  fit(doors_spots);
+  fit(winning_doors_spots);
+  fit(moving_spots);
+
+  if (min_x == INT_MAX) {
+    min_x = min_y = max_x = max_y = 0;
+    width = height = 0;
+    cells.clear();
+    return;
+  }
+
+  // one cell margin, so every neighbour of an indexed spot is indexed too
+  min_x -= 1;
+  min_y -= 1;
+  max_x += 1;
+  max_y += 1;
+  width = max_x - min_x + 1;
+  height = max_y - min_y + 1;
+
+  cells.assign(width * height, empty_cell);
+
+  mark(floor_spots, floor_cell);
+  mark(static_spots, static_cell);
+  mark(winning_doors_spots, winning_cell);
+
+  fr(i, doors_spots) {
+    Cell& cell = cells[index(doors_spots[i])];
+    cell.flags |= door_cell;
+
+    // first door on a spot wins, same as the old linear scan
+    if (cell.door == -1) {
+      cell.door = i;
+      cell.partner = doors_partners[i];
+    }
+  }
+}
+
+
+int Grid::index(const Spot& spot) const
+{
+  int x = spot.x - min_x;
+  int y = spot.y - min_y;
+
+  if (x < 0 || y < 0 || x >= width || y >= height) {
+    return -1;
+  }
+
+  return y * width + x;
+}
+
+
+const Grid::Cell& Grid::at(const Spot& spot) const
+{
+  int i = index(spot);
+
+  return i == -1 ? empty_cell : cells[i];
+}
+
+
+bool Grid::is(const Spot& spot, const uint8_t flag) const
+{
+  return (at(spot).flags & flag) != 0;
+}
+
+
+void Grid::fit(const std::vector<Spot>& spots)
+{
+  fr(i, spots) {
+    if (spots[i].x < min_x) min_x = spots[i].x;
+    if (spots[i].y < min_y) min_y = spots[i].y;
+    if (spots[i].x > max_x) max_x = spots[i].x;
+    if (spots[i].y > max_y) max_y = spots[i].y;
+  }
+}
+
+
+void Grid::mark(const std::vector<Spot>& spots, const uint8_t flag)
+{
+  fr(i, spots) {
+    Cell& cell = cells[index(spots[i])];
+    cell.flags |= flag;
+    if (flag == winning_cell) {
+      cell.winning += 1;
+    }
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef GRID
+#define GRID
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#define fr(i, xs) for(int i = 0; i < (int)xs.size(); ++i)
+
+struct Spot
+{
+  int x;
+  int y;
+};
+
+// Dense occupancy index over the level's bounding box, so the rules can look
+// a spot up instead of scanning every floor/door/winning list.
+struct Grid
+{
+  static const uint8_t floor_cell = 1 << 0;
+  static const uint8_t static_cell = 1 << 1;
+  static const uint8_t door_cell = 1 << 2;
+  static const uint8_t winning_cell = 1 << 3;
+
+  struct Cell
+  {
+    uint8_t flags;
+    uint8_t winning;
+    int16_t door;
+    int16_t partner;
+  };
+
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+  int width;
+  int height;
+
+  std::vector<Cell> cells;
+
+  void build(
+      const std::vector<Spot>& floor_spots,
+      const std::vector<Spot>& static_spots,
+      const std::vector<Spot>& doors_spots,
+      const std::vector<int>& doors_partners,
+      const std::vector<Spot>& winning_doors_spots,
+      const std::vector<Spot>& moving_spots
+      );
+
+  int index(const Spot& spot) const;
+  const Cell& at(const Spot& spot) const;
+  bool is(const Spot& spot, const uint8_t flag) const;
+
+  static const Cell empty_cell;
+
+  void fit(const std::vector<Spot>& spots);
+  void mark(const std::vector<Spot>& spots, const uint8_t flag);
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "hints.hpp"
+#include <stdio.h>
+#include <fstream>
+
+
+bool Hints::build(const WorldState& state, Solver& solver)
+{
+  clear();
+
+  Solver::Result result = solver.explore(state);
+  if (!result.complete) {
+    return false;
+  }
+
+  int nodes_count = solver.hashes.size();
+  int blocks_count = solver.blocks_count;
+
+  // reverse the explored edges, first[n]..first[n + 1] index the edges into n
+  std::vector<int> first(nodes_count + 1, 0);
+  std::vector<int> incoming;
+
+  fr(e, solver.edges) {
+    if (solver.edges[e] != -1) {
+      first[solver.edges[e] + 1] += 1;
+    }
+  }
+  for (int n = 0; n < nodes_count; ++n) {
+    first[n + 1] += first[n];
+  }
+
+  incoming.resize(first[nodes_count]);
+  std::vector<int> fill(first.begin(), first.end() - 1);
+  fr(e, solver.edges) {
+    if (solver.edges[e] != -1) {
+      incoming[fill[solver.edges[e]]++] = e;
+    }
+  }
+
+  // breadth first from every won state at once, backwards along the edges
+  std::vector<int> distances(nodes_count, -1);
+  std::vector<uint8_t> best(nodes_count, 0);
+  std::vector<int> queue;
+  queue.reserve(nodes_count);
+
+  for (int n = 0; n < nodes_count; ++n) {
+    if (solver.won(&solver.states[n * blocks_count])) {
+      distances[n] = 0;
+      queue.push_back(n);
+    }
+  }
+
+  fr(q, queue) {
+    int n = queue[q];
+    for (int i = first[n]; i < first[n + 1]; ++i) {
+      int from = incoming[i] / 4;
+      if (distances[from] == -1) {
+        distances[from] = distances[n] + 1;
+        best[from] = incoming[i] % 4;
+        queue.push_back(from);
+      }
+    }
+  }
+
+  // only winnable states are kept, a miss at runtime means a dead end
+  int size = 16;
+  while (size * 3 < (int)queue.size() * 4) {
+    size *= 2;
+  }
+
+  version = current_version;
+  layout = layoutHash(state);
+  keys.assign(size, 0);
+  values.assign(size, 0);
+
+  fr(q, queue) {
+    int n = queue[q];
+    uint64_t key = solver.hashes[n];
+    if (key == 0 || distances[n] > max_distance) {
+      continue;
+    }
+
+    uint32_t slot = (uint32_t)key & (size - 1);
+    while (keys[slot]) {
+      slot = (slot + 1) & (size - 1);
+    }
+    keys[slot] = key;
+    values[slot] = distances[n] << 2 | best[n];
+  }
+
+  return true;
+}
+
+
+bool Hints::lookup(const std::vector<Spot>& spots, int& distance, int& move) const
+{
+  if (keys.empty()) {
+    return false;
+  }
+
+  uint64_t key = Solver::hash(spots);
+  uint32_t mask = keys.size() - 1;
+
+  for (uint32_t slot = (uint32_t)key & mask; keys[slot]; slot = (slot + 1) & mask) {
+    if (keys[slot] == key) {
+      distance = values[slot] >> 2;
+      move = values[slot] & 3;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+bool Hints::empty() const
+{
+  return keys.empty();
+}
+
+
+void Hints::clear()
+{
+  version = 0;
+  layout = 0;
+  keys.clear();
+  values.clear();
+}
+
+
+uint64_t Hints::layoutHash(const WorldState& state)
+{
+  // everything the rules read, door pairs included
+  const std::vector<Spot>* lists[] = {&state.floor_spots, &state.doors_spots, &state.winning_doors_spots};
+  uint64_t h = 0xcbf29ce484222325ull ^ state.moving_spots.size();
+
+  for (int l = 0; l < 3; ++l) {
+    h = (h ^ lists[l]->size()) * 0x100000001b3ull;
+    fr(i, (*lists[l])) {
+      h = (h ^ Solver::zobrist((*lists[l])[i])) * 0x100000001b3ull;
+    }
+  }
+
+  fr(i, state.doors_partners) {
+    h = (h ^ (uint32_t)state.doors_partners[i]) * 0x100000001b3ull;
+  }
+
+  return h;
+}
+
+
+void Hints::path(char* str, const char* level_path)
+{
+  sprintf(str, "%s.hints", level_path);
+}
+
+
+bool Hints::load(const char* filename, const WorldState& state, Hints& hints)
+{
+  hints.clear();
+
+  std::ifstream is(filename, std::ios::binary);
+  uint32_t size = 0;
+
+  is.read((char*)&hints.version, sizeof(hints.version));
+  is.read((char*)&hints.layout, sizeof(hints.layout));
+  is.read((char*)&size, sizeof(size));
+
+  // missing, stale after the level was edited, or written by an older build
+  if (!is || hints.version != current_version || hints.layout != layoutHash(state) ||
+      size == 0 || size > max_size || (size & (size - 1))) {
+    hints.clear();
+    return false;
+  }
+
+  hints.keys.resize(size);
+  hints.values.resize(size);
+  is.read((char*)hints.keys.data(), size * sizeof(hints.keys[0]));
+  is.read((char*)hints.values.data(), size * sizeof(hints.values[0]));
+
+  if (!is) {
+    hints.clear();
+    return false;
+  }
+
+  return true;
+}
+
+
+void Hints::save(const char* filename, const Hints& hints)
+{
+  std::ofstream os(filename, std::ios::binary);
+  uint32_t size = hints.keys.size();
+
+  os.write((const char*)&hints.version, sizeof(hints.version));
+  os.write((const char*)&hints.layout, sizeof(hints.layout));
+  os.write((const char*)&size, sizeof(size));
+  os.write((const char*)hints.keys.data(), size * sizeof(hints.keys[0]));
+  os.write((const char*)hints.values.data(), size * sizeof(hints.values[0]));
+}
@@ -0,0 +1,40 @@
+#ifndef HINTS
+#define HINTS
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "world_state.hpp"
+#include "solver.hpp"
+
+// Distance to the nearest win and the move that gets there, for every state
+// that can still be won. Built offline by a backwards search from the won
+// states and saved next to the level as "<level>.hints", so the game only
+// hashes the blocks and probes a table after each move.
+//
+// Keys are Solver::hash of the moving spots, slots open addressed with key 0
+// marking an empty one. A value packs distance << 2 | direction. On disk:
+// version, layout hash, slot count, keys, values, all native endian.
+struct Hints
+{
+  static const uint32_t current_version = 1;
+  static const int max_distance = (1 << 14) - 1;
+  static const uint32_t max_size = 1 << 26;
+
+  uint32_t version = 0;
+  uint64_t layout = 0;
+  std::vector<uint64_t> keys;
+  std::vector<uint16_t> values;
+
+  bool build(const WorldState& state, Solver& solver);
+  bool lookup(const std::vector<Spot>& spots, int& distance, int& move) const;
+  bool empty() const;
+  void clear();
+
+  static uint64_t layoutHash(const WorldState& state);
+  static void path(char* str, const char* level_path);
+  static bool load(const char* filename, const WorldState& state, Hints& hints);
+  static void save(const char* filename, const Hints& hints);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "job_pool.hpp"
+#include <unistd.h>
+
+
+void JobPool::init(const int count)
+{
+  workers_count = count > 0 ? count : coresCount();
+  workers = new Worker[workers_count];
+  quit = false;
+
+  for (int i = 0; i < workers_count; ++i) {
+    workers[i].pool = this;
+    workers[i].id = i;
+    workers[i].thread.init(threadFunc, &workers[i], 0, "job_pool");
+  }
+}
+
+
+void JobPool::run(const int jobs_count, JobFn _fn, void* _user_data)
+{
+  fn = _fn;
+  user_data = _user_data;
+
+  for (int i = 0; i < jobs_count; ++i) {
+    workers[i % workers_count].jobs.push_back(i);
+  }
+
+  for (int i = 0; i < workers_count; ++i) {
+    workers[i].wake.post();
+  }
+
+  for (int i = 0; i < workers_count; ++i) {
+    done.wait();
+  }
+}
+
+
+void JobPool::shutdown()
+{
+  quit = true;
+
+  for (int i = 0; i < workers_count; ++i) {
+    workers[i].wake.post();
+  }
+
+  for (int i = 0; i < workers_count; ++i) {
+    workers[i].thread.shutdown();
+  }
+
+  delete[] workers;
+  workers = NULL;
+}
+
+
+bool JobPool::take(const int worker, int& job)
+{
+  {
+    Worker& own = workers[worker];
+    bx::MutexScope lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = own.jobs.back();
+      own.jobs.pop_back();
+      return true;
+    }
+  }
+
+  for (int i = 1; i < workers_count; ++i) {
+    Worker& victim = workers[(worker + i) % workers_count];
+    bx::MutexScope lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = victim.jobs.front();
+      victim.jobs.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+int32_t JobPool::threadFunc(bx::Thread* thread, void* user_data)
+{
+  Worker* worker = (Worker*)user_data;
+  JobPool* pool = worker->pool;
+  int job;
+
+  while (true) {
+    worker->wake.wait();
+    if (pool->quit) {
+      return 0;
+    }
+
+    while (pool->take(worker->id, job)) {
+      pool->fn(job, worker->id, pool->user_data);
+    }
+
+    pool->done.post();
+  }
+}
+
+
+int JobPool::coresCount()
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return count > 0 ? (int)count : 1;
+}
@@ -0,0 +1,43 @@
+#ifndef JOB_POOL
+#define JOB_POOL
+#pragma once
+
+#include <deque>
+#include <bx/thread.h>
+#include <bx/mutex.h>
+#include <bx/semaphore.h>
+
+// Work stealing pool: every worker owns a deque of job ids, pops from its
+// back and steals from the front of the others once it runs dry.
+struct JobPool
+{
+  typedef void (*JobFn)(const int job, const int worker, void* user_data);
+
+  struct Worker
+  {
+    JobPool* pool;
+    int id;
+    bx::Thread thread;
+    bx::Semaphore wake;
+    bx::Mutex mutex;
+    std::deque<int> jobs;
+  };
+
+  int workers_count;
+  Worker* workers;
+
+  JobFn fn;
+  void* user_data;
+  bool quit;
+  bx::Semaphore done;
+
+  void init(const int count = 0);
+  void run(const int jobs_count, JobFn _fn, void* _user_data);
+  void shutdown();
+
+  bool take(const int worker, int& job);
+  static int32_t threadFunc(bx::Thread* thread, void* user_data);
+  static int coresCount();
+};
+
+#endif
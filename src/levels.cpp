@@ -0,0 +1,49 @@
+#include "levels.hpp"
+#include <stdio.h>
+#include <fstream>
+#include "../cereal/include/cereal/archives/json.hpp"
+
+void Levels::loadList(std::vector<Level>& levels, const char* filename)
+{
+  std::ifstream is(filename, std::ios::binary);
+  cereal::JSONInputArchive ar(is);
+  ar(levels);
+}
+
+void Levels::saveList(const std::vector<Level>& levels, const char* filename)
+{
+  std::ofstream os(filename, std::ios::binary);
+  cereal::JSONOutputArchive ar(os);
+  ar(levels);
+}
+
+void Levels::load(const char* filename, WorldState& state)
+{
+  std::ifstream is(filename, std::ios::binary);
+  cereal::JSONInputArchive ar(is);
+  ar(state);
+}
+
+void Levels::save(const char* filename, WorldState& state)
+{
+  std::ofstream os(filename, std::ios::binary);
+  cereal::JSONOutputArchive ar(os);
+  ar(state);
+}
+
+void Levels::path(char* str, const Level& level)
+{
+  sprintf(str, "levels/%s", level.filename.c_str());
+}
+
+void Levels::label(char* str, const Level& level)
+{
+  // cloned levels carry ctime()'s newlines in their names
+  int n = 0;
+  fr(i, level.filename) {
+    if (level.filename[i] != '\n' || i + 1 < (int)level.filename.size()) {
+      str[n++] = level.filename[i] == '\n' ? ' ' : level.filename[i];
+    }
+  }
+  str[n] = '\0';
+}
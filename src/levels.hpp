@@ -0,0 +1,42 @@
+#ifndef LEVELS
+#define LEVELS
+#pragma once
+
+#include <string>
+#include <vector>
+#include "../cereal/include/cereal/types/vector.hpp"
+#include "world_state.hpp"
+
+struct Level
+{
+  std::string filename;
+  std::string note;
+
+  template<class Archive>
+  void serialize(Archive& archive)
+  {
+    archive(filename, note);
+  }
+};
+
+namespace cereal
+{
+  template<class Archive>
+  void serialize(Archive& archive,
+      Spot& m)
+  {
+    archive(m.x, m.y);
+  }
+}
+
+struct Levels
+{
+  static void loadList(std::vector<Level>& levels, const char* filename = "levels/levels_list");
+  static void saveList(const std::vector<Level>& levels, const char* filename = "levels/levels_list");
+  static void load(const char* filename, WorldState& state);
+  static void save(const char* filename, WorldState& state);
+  static void path(char* str, const Level& level);
+  static void label(char* str, const Level& level);
+};
+
+#endif
@@ -14,9 +14,12 @@
 
 #include "common.hpp"
 #include "world.hpp"
+#include "levels.hpp"
 #include "editor.hpp"
 #include "buffer_object.hpp"
 #include "textures.hpp"
+#include "job_pool.hpp"
+#include "arena.hpp"
 
 SDL_Window* window = NULL;
 const int WIDTH = 1600;
@@ -24,21 +27,9 @@ const int HEIGHT = 1000;
 const int w = WIDTH;
 const int h = HEIGHT;
 
-struct Level
-{
-  std::string filename;
-  std::string note;
-
-  template<class Archive>
-  void serialize(Archive& archive)
-  {
-    archive(filename, note);
-  }
-};
-
-
 int current_level_id = 0;
 char level_str[255];
+char hints_str[255];
 Level new_level;
 
 std::vector<Level> levels;
@@ -55,53 +46,45 @@ namespace cereal
   {
     archive(m.x, m.y, m.z);
   }
-
-  template<class Archive>
-  void serialize(Archive& archive,
-      Spot& m)
-  {
-    archive(m.x, m.y);
-  }
 }
 
 void loadLevels()
 {
-  std::ifstream is("levels/levels_list", std::ios::binary);
-  cereal::JSONInputArchive ar(is);
-  ar(levels);
+  Levels::loadList(levels);
 }
 
 void saveLevels()
 {
-  std::ofstream os("levels/levels_list", std::ios::binary);
-  cereal::JSONOutputArchive ar(os);
-  ar(levels);
+  Levels::saveList(levels);
 }
 
 void load(const char* filename)
 {
-  std::ifstream is(filename, std::ios::binary);
-  cereal::JSONInputArchive ar(is);
-  ar(world);
+  Levels::load(filename, world.state);
 }
 
 void save(const char* filename)
 {
-  std::ofstream os(filename, std::ios::binary);
-  cereal::JSONOutputArchive ar(os);
-  ar(world);
+  Levels::save(filename, world.state);
 }
 
 void runLevel(int level_id)
 {
   current_level_id = level_id;
   sprintf(level_str, "levels/%s", levels[current_level_id].filename.c_str());
-  load(level_str);
   SDL_SetWindowTitle(window, level_str);
 
-  world.all_moving_spots.clear();
+  // the static layers come from the cache next to the level when nothing
+  // changed, checked before the level is parsed
+  world.loadBaked(level_str);
+  load(level_str);
   world.init();
   world.updateBuffers();
+
+  // after init, the layout hash covers door pairs derived from old files
+  Hints::path(hints_str, level_str);
+  Hints::load(hints_str, world.state, world.hints);
+  world.updateHint();
 }
 
 void persistLevel(int level_id)
@@ -172,6 +155,11 @@ int main (int argc, char* args[])
   editor.world = &world;
   world.prepare();
 
+  // big levels encode their draws on these, each through its own encoder
+  JobPool encode_pool;
+  encode_pool.init();
+  world.queue.pool = &encode_pool;
+
   loadLevels();
   runLevel(1);
 
@@ -300,8 +288,8 @@ int main (int argc, char* args[])
 
   quad_ms[0] = -2;
 
-  deferred_quad_bo1.writeQuadsVertices(0, quad_vs, quad_cs, quad_ms);
-  deferred_quad_bo2.writeQuadsVertices(0, quad_vs, quad_cs, quad_ms);
+  deferred_quad_bo1.writeQuadsVertices(0, quad_vs.data(), quad_cs.data(), quad_vs.size(), quad_ms);
+  deferred_quad_bo2.writeQuadsVertices(0, quad_vs.data(), quad_cs.data(), quad_vs.size(), quad_ms);
 
 
 
@@ -314,6 +302,7 @@ int main (int argc, char* args[])
 
   float view[16];
   float proj[16];
+  float view_proj[16];
   float proj2[16];
   const bgfx::Caps* caps = bgfx::getCaps();
 
@@ -324,6 +313,8 @@ int main (int argc, char* args[])
   bool back = false;
   bool reset = false;
   bool moved = false;
+  bool show_hint = false;
+  const char* hint_names[4] = {"left", "right", "up", "down"};
 
 
   bx::Vec3 at  = { 0.0f, -4.0f,   0.0f };
@@ -391,15 +382,19 @@ int main (int argc, char* args[])
             break;
 
           case SDLK_r:
-            if (world.all_moving_spots.empty()) break;
+            if (!world.state.canUndo()) break;
             reset = true;
             break;
 
           case SDLK_z:
-            if (world.all_moving_spots.empty()) break;
+            if (!world.state.canUndo()) break;
             back = true;
             break;
 
+          case SDLK_t:
+            show_hint = !show_hint;
+            break;
+
           case SDLK_v:
             runLevel(current_level_id - 1);
             break;
@@ -441,18 +436,18 @@ int main (int argc, char* args[])
           case SDLK_u:
             // moving/user
             if (!in_editor) break;
-            editor.add(world.moving_spots, world.editor_spot[0], world.moving_bo);
+            editor.add(world.state.moving_spots, world.editor_spot[0], world.moving_bo);
             break;
 
           case SDLK_i:
             // static
             if (!in_editor) break;
             {
-              int i = editor.find(world. static_spots, world.editor_spot[0]);
+              int i = editor.find(world.state.static_spots, world.editor_spot[0]);
               if (i == -1) {
-                editor.add(world.static_spots, world.editor_spot[0], world.static_bo, world.static_models_list, 3);
+                editor.add(world.state.static_spots, world.editor_spot[0], world.static_bo, world.state.static_models_list, 3);
               } else {
-                editor.next_mapping(i, world.static_bo, world.static_models_list, 5);
+                editor.next_mapping(i, world.static_bo, world.state.static_models_list, 5);
               }
             }
             break;
@@ -460,24 +455,24 @@ int main (int argc, char* args[])
           case SDLK_o:
             // winnning
             if (!in_editor) break;
-            editor.add(world.winning_doors_spots, world.editor_spot[0], world.winning_doors_bo);
+            editor.add(world.state.winning_doors_spots, world.editor_spot[0], world.winning_doors_bo);
             break;
 
           case SDLK_j:
             // gate
             if (!in_editor) break;
-            editor.add(world.doors_spots, world.editor_spot[0], world.doors_bo);
+            editor.addDoor(world.editor_spot[0]);
             break;
 
           case SDLK_y:
             // tiles
             if (!in_editor) break;
             {
-              int i = editor.find(world.tiles_spots, world.editor_spot[0]);
+              int i = editor.find(world.state.tiles_spots, world.editor_spot[0]);
               if (i == -1) {
-                editor.add(world.tiles_spots, world.editor_spot[0], world.tiles_bo, world.tiles_mapping_ids, 0);
+                editor.add(world.state.tiles_spots, world.editor_spot[0], world.tiles_bo, world.state.tiles_mapping_ids, 0);
               } else {
-                editor.next_mapping(i, world.tiles_bo, world.tiles_mapping_ids, world.tiles_bo.textures.mappings.size());
+                editor.next_mapping(i, world.tiles_bo, world.state.tiles_mapping_ids, world.tiles_bo.textures.mappings.size());
               }
             }
             break;
@@ -486,11 +481,11 @@ int main (int argc, char* args[])
             // floor
             if (!in_editor) break;
             {
-              int i = editor.find(world.floor_spots, world.editor_spot[0]);
+              int i = editor.find(world.state.floor_spots, world.editor_spot[0]);
               if (i == -1) {
-                editor.add(world.floor_spots, world.editor_spot[0], world.floor_bo, world.floor_models_list, 0);
+                editor.add(world.state.floor_spots, world.editor_spot[0], world.floor_bo, world.state.floor_models_list, 0);
               } else {
-                editor.next_mapping(i, world.floor_bo, world.floor_models_list, 1);
+                editor.next_mapping(i, world.floor_bo, world.state.floor_models_list, 1);
               }
             }
             break;
@@ -606,24 +601,29 @@ int main (int argc, char* args[])
     u_twh_val[0] = current_time;
     bgfx::setUniform(u_twh, &u_twh_val);
 
+    // the door shaders take at most 20 positions
+    int doors_count = bx::min((int)world.doors_positions.size(), 20);
+
     bool through = false;
     fr(i, world.through_door) {
       if (world.through_door[i]) through = true;
     }
     if (through) {
-      u_doors_val[0] = (float)world.doors_positions.size();
+      u_doors_val[0] = (float)doors_count;
     } else {
       u_doors_val[0] = 0.0f;
     }
 
-    fr(i, world.doors_positions) {
+    for (int i = 0; i < doors_count; ++i) {
       u_doors_val[(i + 1) * 4 + 0] = world.doors_positions[i].x;
       // u_doors_val[(i + 1) * 4 + 1] = world.doors_positions[i].y;
       u_doors_val[(i + 1) * 4 + 2] = world.doors_positions[i].z;
     }
-    bgfx::setUniform(u_doors, u_doors_val, world.doors_positions.size() + 1);
+    bgfx::setUniform(u_doors, u_doors_val, doors_count + 1);
 
-    world.draw(in_editor);
+    // the baked static layers only submit the chunks in view
+    bx::mtxMul(view_proj, view, proj);
+    world.draw(in_editor, view_proj);
 
     // bgfx::blit(deferred_view, texture_handles[0], 0, 0, m_gbufferTex[0], 0, 0);
 
@@ -634,6 +634,17 @@ int main (int argc, char* args[])
 
     deferred_quad_bo2.drawQuads(main_view, 1);
 
+    bgfx::dbgTextClear();
+    if (show_hint && !in_editor) {
+      if (world.hints.empty()) {
+        bgfx::dbgTextPrintf(1, 1, 0x0f, "no hints for this level, run ./hints");
+      } else if (world.hint_distance == -1) {
+        bgfx::dbgTextPrintf(1, 1, 0x0f, "no way to win from here, undo");
+      } else {
+        bgfx::dbgTextPrintf(1, 1, 0x0f, "%d moves to go, next %s", world.hint_distance, hint_names[world.hint_move]);
+      }
+    }
+
     bgfx::frame();
 
     last_time = current_time;
@@ -641,10 +652,12 @@ int main (int argc, char* args[])
   }
 
   world.destroy();
+  encode_pool.shutdown();
   bgfx::destroy(u_twh);
   bgfx::destroy(u_doors);
 
   bgfx::shutdown();
+  Arena::run().release();
   // Free up window
   SDL_DestroyWindow(window);
   // Shutdown SDL
@@ -1,4 +1,5 @@
 #include "models.hpp"
+#include "arena.hpp"
 
 void Models::processMesh(aiMesh *mesh, const aiScene *scene, int& vertices_offset, int& indices_offset)
 {
@@ -38,7 +39,7 @@ void Models::processMesh(aiMesh *mesh, const aiScene *scene, int& vertices_offse
 }
 
 
-int Models::processNode(aiNode* node, const aiScene* scene, int& vertices_offset, int& indices_offset)
+void Models::processNode(aiNode* node, const aiScene* scene, int& vertices_offset, int& indices_offset)
 {
   // printf("Node with %d meshes and %d children.\n", node->mNumMeshes, node->mNumChildren);
   for(int i = 0; i < node->mNumMeshes; ++i) {
@@ -53,10 +54,11 @@ int Models::processNode(aiNode* node, const aiScene* scene, int& vertices_offset
 
 void Models::init()
 {
-  vertices = new AnimatedPosColorTexVertex[vertices_count];
-  indices = new uint16_t[indices_count];
+  vertices = Arena::run().alloc<PosColorTexVertex>(vertices_count);
+  indices = Arena::run().alloc<uint16_t>(indices_count);
   vertices_offsets[0] = 0;
   indices_offsets[0] = 0;
+  models_count = 0;
 
   // import("cube.obj", 0);
   //
@@ -96,6 +98,7 @@ void Models::import(const char* filename, const int nth)
 
   vertices_offsets[nth + 1] = acc_next_vertices_offset;
   indices_offsets[nth + 1] = acc_next_indices_offset;
+  models_count = bx::max(models_count, nth + 1);
 
   aiReleaseImport(scene);
 }
@@ -132,6 +135,7 @@ void Models::set
 
   vertices_offsets[nth + 1] = vertices_offset + model_vertices.size();
   indices_offsets[nth + 1] = indices_offset + model_indices.size();
+  models_count = bx::max(models_count, nth + 1);
 }
 
 
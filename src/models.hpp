@@ -4,6 +4,8 @@
 
 #include "common.hpp"
 #include <bx/math.h>
+#include <assert.h>
+#include <string.h>
 #include <stdio.h>
 #include <vector>
 #include <assimp/cimport.h>
@@ -11,7 +13,8 @@
 #include <assimp/postprocess.h>
 
 
-struct AnimatedPosColorTexVertex {
+// meshes as Models loads them, full precision and cpu side only
+struct PosColorTexVertex {
   float x;
   float y;
   float z;
@@ -22,33 +25,128 @@ struct AnimatedPosColorTexVertex {
   float normal_y;
   float normal_z;
 
+  float texcoord_x1;
+  float texcoord_y1;
+};
+
+
+// stream 0 of every buffer, 24 bytes: half positions, unorm8 colours,
+// snorm16 normals and uvs. Colours clamp to [0, 1], uvs to [-1, 1] which
+// keeps the -1 "untextured" marker. Static buffers bake the model's
+// position in, so keep levels within half precision of the origin
+struct PackedPosColorTexVertex {
+  uint16_t x;
+  uint16_t y;
+  uint16_t z;
+  uint16_t pad0;
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t a;
+  int16_t normal_x;
+  int16_t normal_y;
+  int16_t normal_z;
+  int16_t pad1;
+
+  int16_t texcoord_x1;
+  int16_t texcoord_y1;
+
+
+  void setPosition(const float _x, const float _y, const float _z)
+  {
+    x = half(_x);
+    y = half(_y);
+    z = half(_z);
+  }
+
+  void setColor(const float _r, const float _g, const float _b)
+  {
+    r = unorm8(_r);
+    g = unorm8(_g);
+    b = unorm8(_b);
+    a = 255;
+  }
+
+  void setNormal(const float _x, const float _y, const float _z)
+  {
+    normal_x = snorm16(_x);
+    normal_y = snorm16(_y);
+    normal_z = snorm16(_z);
+  }
+
+  void setTexcoord(const float _x, const float _y)
+  {
+    texcoord_x1 = snorm16(_x);
+    texcoord_y1 = snorm16(_y);
+  }
+
+  // rounds to nearest, flushes what is too small for a normal half to zero
+  // and what is too big to infinity, none of which a level gets near
+  static uint16_t half(const float v)
+  {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent <= 0) {
+      return sign;
+    }
+    if (exponent >= 31) {
+      return sign | 0x7c00;
+    }
+
+    // a carry out of the mantissa bumps the exponent, as it should
+    return sign | (((exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+  }
+
+  static uint8_t unorm8(const float v)
+  {
+    return v <= 0.0f ? 0 : v >= 1.0f ? 255 : (uint8_t)(v * 255.0f + 0.5f);
+  }
+
+  static int16_t snorm16(const float v)
+  {
+    return v <= -1.0f ? -32767 : v >= 1.0f ? 32767 : (int16_t)(v * 32767.0f + (v < 0.0f ? -0.5f : 0.5f));
+  }
+
+
+  static void init() {
+    ms_layout
+      .begin()
+      // three halfs or int16s are 6 bytes on gl and metal but 8 on d3d,
+      // four are 8 everywhere: pad0 and pad1 ride along as unused w
+      .add(bgfx::Attrib::Position, 4, bgfx::AttribType::Half)
+      .add(bgfx::Attrib::Color0,   4, bgfx::AttribType::Uint8, true)
+      .add(bgfx::Attrib::Normal,   4, bgfx::AttribType::Int16, true)
+
+      .add(bgfx::Attrib::TexCoord0,2, bgfx::AttribType::Int16, true)
+
+      .end();
+    assert(ms_layout.getStride() == sizeof(PackedPosColorTexVertex));
+  };
+
+  static bgfx::VertexLayout ms_layout;
+};
+
+
+// stream 1, only bound for animated buffers: the second keyframe's mesh,
+// the times the shaders morph between the two, and which placed model the
+// vertex belongs to. Placements and colours are per model, in a uniform
+struct AnimationVertex {
   float x2;
   float y2;
   float z2;
-  float r2;
-  float g2;
-  float b2;
   float normal_x2;
   float normal_y2;
   float normal_z2;
 
-  float pos_x1;
-  float pos_y1;
-  float pos_z1;
-
-  float pos_x2;
-  float pos_y2;
-  float pos_z2;
-
   float model_from;
-  float color_from;
-  float pos_from;
   float model_to;
-  float color_to;
-  float pos_to;
+  float object;
 
-  float texcoord_x1;
-  float texcoord_y1;
   float texcoord_x2;
   float texcoord_y2;
 
@@ -56,21 +154,11 @@ struct AnimatedPosColorTexVertex {
   static void init() {
     ms_layout
       .begin()
-      .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Color0,   3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Normal,   3, bgfx::AttribType::Float)
-
       .add(bgfx::Attrib::Tangent,   3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Color1,    3, bgfx::AttribType::Float)
       .add(bgfx::Attrib::Bitangent, 3, bgfx::AttribType::Float)
 
-      .add(bgfx::Attrib::Color2,   3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Color3,   3, bgfx::AttribType::Float)
-
       .add(bgfx::Attrib::Indices,  3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Weight,   3, bgfx::AttribType::Float)
 
-      .add(bgfx::Attrib::TexCoord0,2, bgfx::AttribType::Float)
       .add(bgfx::Attrib::TexCoord1,2, bgfx::AttribType::Float)
 
       .end();
@@ -84,11 +172,13 @@ struct Models
 {
   const int vertices_count = 10000;
   const int indices_count = 10000;
-  AnimatedPosColorTexVertex* vertices;
+  PosColorTexVertex* vertices;
   uint16_t* indices;
 
-  uint16_t vertices_offsets[100];
-  uint16_t indices_offsets[100];
+  // indices stay 16 bit, they are local to their mesh
+  uint32_t vertices_offsets[100];
+  uint32_t indices_offsets[100];
+  int models_count = 0;
 
   void init();
   void import(const char* filename, const int nth);
@@ -97,7 +187,7 @@ struct Models
   int nth_model_vertices_count(int nth) const;
   int nth_model_indices_count(int nth) const;
 
-  int processNode(aiNode* node, const aiScene* scene, int& vertices_offset, int& indices_offset);
+  void processNode(aiNode* node, const aiScene* scene, int& vertices_offset, int& indices_offset);
   void processMesh(aiMesh *mesh, const aiScene *scene, int& vertices_offset, int& indices_offset);
 
   char filename_str[255];
@@ -0,0 +1,314 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <tuple>
+#include <string.h>
+
+
+void RenderQueue::begin(const float* view_proj_)
+{
+  items.clear();
+
+  has_view_proj = view_proj_ != NULL;
+  if (has_view_proj) {
+    memcpy(view_proj, view_proj_, sizeof(view_proj));
+  }
+}
+
+
+uint32_t RenderQueue::depth(const float* min, const float* max) const
+{
+  if (!has_view_proj || !min || !max) {
+    return 0;
+  }
+
+  // clip w grows with the distance in front of the eye, behind it is 0
+  float x = (min[0] + max[0]) * 0.5f;
+  float y = (min[1] + max[1]) * 0.5f;
+  float z = (min[2] + max[2]) * 0.5f;
+  float w = x * view_proj[3] + y * view_proj[7] + z * view_proj[11] + view_proj[15];
+  if (!(w > 0.0f)) {
+    return 0;
+  }
+
+  // positive floats order like their bits
+  uint32_t bits;
+  memcpy(&bits, &w, sizeof(bits));
+  return bits;
+}
+
+
+void RenderQueue::add(Item& item, const float* min, const float* max)
+{
+  if (item.indices_count == 0) {
+    return;
+  }
+
+  bool blend = (item.state & BGFX_STATE_BLEND_MASK) != 0;
+  item.depth = depth(min, max);
+  if (blend) {
+    item.depth = ~item.depth;
+  }
+
+  item.key = 0
+    | uint64_t(item.view) << 49
+    | uint64_t(blend) << 48
+    | uint64_t(item.program.idx) << 32
+    | item.depth;
+  item.seq = items.size();
+
+  items.push_back(item);
+}
+
+
+RenderQueue::Item RenderQueue::dynamicItem(bgfx::ViewId view, BufferObject& bo, uint64_t more_state)
+{
+  Item item;
+  memset(&item, 0, sizeof(item));
+
+  item.view = view;
+  item.state = more_state;
+  item.program = bo.m_program;
+  item.textures = &bo.textures;
+  item.dynamic = true;
+  item.vbh = bo.transient ? bgfx::kInvalidHandle : bo.m_vbh.idx;
+  item.abh = bo.animations && !bo.transient ? bo.m_abh.idx : bgfx::kInvalidHandle;
+  item.ibh = bo.transient ? bgfx::kInvalidHandle : bo.m_ibh.idx;
+  item.instances_vbh = bgfx::kInvalidHandle;
+
+  return item;
+}
+
+
+void RenderQueue::addBuffer
+(bgfx::ViewId view, BufferObject& bo, uint32_t vertices_count, uint32_t indices_count, uint64_t more_state)
+{
+  Item item = dynamicItem(view, bo, more_state);
+  item.vertices_count = vertices_count;
+  item.indices_count = indices_count;
+
+  if (bo.transient) {
+    if (indices_count == 0 || !bo.allocTransient(vertices_count, indices_count)) {
+      return;
+    }
+    item.transient = true;
+    item.tvb = bo.m_tvb;
+    item.tab = bo.m_tab;
+    item.tib = bo.m_tib;
+  }
+
+  if (!bo.animations) {
+    add(item, NULL, NULL);
+    return;
+  }
+
+  // an item per group of models, the vertices stay whole as the indices
+  // address them from the start
+  item.uniform = bo.u_animation;
+  for (int g = 0; g < bo.animationGroupsCount(); ++g) {
+    BufferObject::AnimationGroup group = bo.animationGroup(g, indices_count);
+    item.first_index = group.first_index;
+    item.indices_count = group.indices_count;
+    item.uniform_data = group.records;
+    item.uniform_num = group.records_num;
+    add(item, NULL, NULL);
+  }
+}
+
+
+void RenderQueue::addModels(bgfx::ViewId view, BufferObject& bo, uint64_t more_state)
+{
+  if (!bo.instanced) {
+    addBuffer(view, bo, bo.models_vertices_count, bo.models_indices_count, more_state);
+    return;
+  }
+
+  // instance buffers only live for a frame, refilled per placed model from
+  // the cpu copy
+  const Models& models = bo.models;
+  for (int nth = 0; nth < (int)bo.instances_counts.size(); ++nth) {
+    if (bo.instances_counts[nth] == 0) {
+      continue;
+    }
+
+    Item item = dynamicItem(view, bo, more_state);
+    item.first_vertex = models.vertices_offsets[nth];
+    item.vertices_count = models.nth_model_vertices_count(nth);
+    item.first_index = models.indices_offsets[nth];
+    item.indices_count = models.nth_model_indices_count(nth);
+
+    uint32_t count = bgfx::getAvailInstanceDataBuffer(bo.instances_counts[nth], sizeof(InstanceData));
+    if (count == 0) {
+      continue;
+    }
+    bgfx::allocInstanceDataBuffer(&item.idb, count, sizeof(InstanceData));
+    bx::memCopy(item.idb.data, &bo.instances[bo.instances_offsets[nth]], count * sizeof(InstanceData));
+    item.instances_count = count;
+
+    add(item, NULL, NULL);
+  }
+}
+
+
+void RenderQueue::addQuads(bgfx::ViewId view, BufferObject& bo, uint32_t quads_count, uint64_t more_state)
+{
+  addBuffer(view, bo, quads_count * 4, quads_count * 6, more_state);
+}
+
+
+void RenderQueue::addCubes(bgfx::ViewId view, BufferObject& bo, uint32_t cubes_count, uint64_t more_state)
+{
+  addBuffer(view, bo, cubes_count * vertices_per_cube_count, cubes_count * indices_per_cube_count, more_state);
+}
+
+
+// same buffers and bindings first, then by where the ranges start
+bool RenderQueue::batched(const Item& a, const Item& b)
+{
+  return
+    std::tie(a.view, a.state, a.program.idx, a.textures, a.dynamic, a.vbh, a.abh, a.ibh, a.instances_vbh,
+        a.first_vertex, a.first_index, a.first_instance) <
+    std::tie(b.view, b.state, b.program.idx, b.textures, b.dynamic, b.vbh, b.abh, b.ibh, b.instances_vbh,
+        b.first_vertex, b.first_index, b.first_instance);
+}
+
+
+// b draws what a would draw next, more indices of one mesh or more
+// instances of it
+bool RenderQueue::continues(const Item& a, const Item& b)
+{
+  if (a.view != b.view || a.state != b.state || a.program.idx != b.program.idx || a.textures != b.textures ||
+      a.dynamic != b.dynamic || a.vbh != b.vbh || a.abh != b.abh || a.ibh != b.ibh ||
+      a.instances_vbh != b.instances_vbh || a.first_vertex != b.first_vertex ||
+      a.idb.num > 0 || b.idb.num > 0 || a.transient || b.transient ||
+      a.uniform_num > 0 || b.uniform_num > 0) {
+    return false;
+  }
+
+  if (a.instances_count == 0 && b.instances_count == 0) {
+    return b.first_index == a.first_index + a.indices_count;
+  }
+
+  return
+    a.first_index == b.first_index &&
+    a.indices_count == b.indices_count &&
+    b.first_instance == a.first_instance + a.instances_count;
+}
+
+
+void RenderQueue::submit()
+{
+  std::sort(items.begin(), items.end(), batched);
+
+  merged.clear();
+  for (int i = 0; i < (int)items.size(); ++i) {
+    if (merged.empty() || !continues(merged.back(), items[i])) {
+      merged.push_back(items[i]);
+      continue;
+    }
+
+    // the nearest part places an opaque run, the farthest a blended one
+    Item& run = merged.back();
+    run.vertices_count = std::max(run.vertices_count, items[i].vertices_count);
+    if (items[i].instances_count > 0) {
+      run.instances_count += items[i].instances_count;
+    } else {
+      run.indices_count += items[i].indices_count;
+    }
+    if (items[i].key < run.key) {
+      run.key = items[i].key;
+      run.depth = items[i].depth;
+    }
+    run.seq = std::min(run.seq, items[i].seq);
+  }
+
+  std::sort(merged.begin(), merged.end(), [](const Item& a, const Item& b) {
+    return a.key != b.key ? a.key < b.key : a.seq < b.seq;
+  });
+
+  // at most one run per worker and per encoder past the main thread's
+  int runs_count = 1;
+  if (pool) {
+    int encoders_count = bgfx::getCaps()->limits.maxEncoders - 1;
+    runs_count = std::min((int)merged.size() / min_items_per_job, std::min(pool->workers_count, encoders_count));
+  }
+
+  if (runs_count > 1) {
+    encoded.assign(runs_count, 0);
+    pool->run(runs_count, encodeJob, this);
+
+    for (int r = 0; r < runs_count; ++r) {
+      if (!encoded[r]) {
+        encodeRun(bgfx::begin(), r, runs_count);
+      }
+    }
+  } else {
+    encodeRun(bgfx::begin(), 0, 1);
+  }
+
+  items.clear();
+}
+
+
+void RenderQueue::encodeRun(bgfx::Encoder* encoder, const int run, const int runs_count)
+{
+  int from = merged.size() * run / runs_count;
+  int to = merged.size() * (run + 1) / runs_count;
+
+  for (int i = from; i < to; ++i) {
+    encode(encoder, merged[i]);
+  }
+}
+
+
+void RenderQueue::encodeJob(const int job, const int worker, void* user_data)
+{
+  RenderQueue* queue = (RenderQueue*)user_data;
+
+  bgfx::Encoder* encoder = bgfx::begin(true);
+  if (!encoder) {
+    return;
+  }
+
+  queue->encodeRun(encoder, job, queue->encoded.size());
+  bgfx::end(encoder);
+  queue->encoded[job] = 1;
+}
+
+
+void RenderQueue::encode(bgfx::Encoder* encoder, const Item& item)
+{
+  encoder->setState(draw_state | item.state);
+  if (item.transient) {
+    encoder->setVertexBuffer(0, &item.tvb, item.first_vertex, item.vertices_count);
+    if (bgfx::isValid(item.tab.handle)) {
+      encoder->setVertexBuffer(1, &item.tab, item.first_vertex, item.vertices_count);
+    }
+    encoder->setIndexBuffer(&item.tib, item.first_index, item.indices_count);
+  } else if (item.dynamic) {
+    bgfx::DynamicVertexBufferHandle vbh = {item.vbh};
+    bgfx::DynamicVertexBufferHandle abh = {item.abh};
+    bgfx::DynamicIndexBufferHandle ibh = {item.ibh};
+    encoder->setVertexBuffer(0, vbh, item.first_vertex, item.vertices_count);
+    if (bgfx::isValid(abh)) {
+      encoder->setVertexBuffer(1, abh, item.first_vertex, item.vertices_count);
+    }
+    encoder->setIndexBuffer(ibh, item.first_index, item.indices_count);
+  } else {
+    bgfx::VertexBufferHandle vbh = {item.vbh};
+    bgfx::IndexBufferHandle ibh = {item.ibh};
+    encoder->setVertexBuffer(0, vbh, item.first_vertex, item.vertices_count);
+    encoder->setIndexBuffer(ibh, item.first_index, item.indices_count);
+  }
+  if (item.idb.num > 0) {
+    encoder->setInstanceDataBuffer(&item.idb);
+  } else if (item.instances_count > 0) {
+    bgfx::VertexBufferHandle instances_vbh = {item.instances_vbh};
+    encoder->setInstanceDataBuffer(instances_vbh, item.first_instance, item.instances_count);
+  }
+  if (item.uniform_num > 0) {
+    encoder->setUniform(item.uniform, item.uniform_data, item.uniform_num);
+  }
+  item.textures->setTexture(encoder);
+
+  encoder->submit(item.view, item.program, item.depth);
+}
@@ -0,0 +1,95 @@
+#ifndef RENDER_QUEUE
+#define RENDER_QUEUE
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <bgfx/bgfx.h>
+
+#include "buffer_object.hpp"
+#include "job_pool.hpp"
+
+// A frame's draws, collected and then submitted sorted by view, opaque
+// before blended, program and depth: opaque front to back so the depth
+// test rejects more, blended back to front so they compose. Before that,
+// draws continuing one another in the same buffers, with the same program,
+// state and textures, merge into one, like neighbouring chunks that both
+// passed the cull. The depth goes along to bgfx, whose own sort in the
+// default view mode orders the same way.
+//
+// Depth is the clip w of a draw's box centre, 0 without a box or a view
+// projection, inverted for blended draws so the key always ascends.
+//
+// With a pool and enough draws, the sorted draws are split into even runs
+// encoded on the workers, each through its own bgfx encoder. bgfx sorts
+// every encoder's draws together by the same keys, so the split changes
+// nothing on screen. A run that finds no free encoder is encoded on the
+// calling thread afterwards.
+struct RenderQueue
+{
+  struct Item
+  {
+    uint64_t key;
+    uint32_t seq;
+    uint32_t depth;
+    bgfx::ViewId view;
+    uint64_t state;
+    bgfx::ProgramHandle program;
+    Textures* textures;
+    // a Baked's immutable buffers, or a BufferObject's dynamic ones, as
+    // raw indices so both kinds share the item
+    bool dynamic;
+    uint16_t vbh;
+    uint16_t abh;
+    uint16_t ibh;
+    uint16_t instances_vbh;
+    uint32_t first_vertex;
+    uint32_t vertices_count;
+    uint32_t first_index;
+    uint32_t indices_count;
+    uint32_t first_instance;
+    uint32_t instances_count;
+    // transient instances, used instead of instances_vbh when num is set
+    bgfx::InstanceDataBuffer idb;
+    // an animated BufferObject's records for one group of models, num 0
+    // for none
+    bgfx::UniformHandle uniform;
+    const void* uniform_data;
+    uint16_t uniform_num;
+    // a transient BufferObject's copies for this frame, instead of vbh,
+    // abh and ibh
+    bool transient;
+    bgfx::TransientVertexBuffer tvb;
+    bgfx::TransientVertexBuffer tab;
+    bgfx::TransientIndexBuffer tib;
+  };
+
+  std::vector<Item> items;
+  std::vector<Item> merged;
+
+  float view_proj[16];
+  bool has_view_proj = false;
+
+  // set by the owner, runs below min_items_per_job stay on the calling thread
+  JobPool* pool = NULL;
+  static const int min_items_per_job = 64;
+  std::vector<uint8_t> encoded;
+
+  void begin(const float* view_proj);
+  void add(Item& item, const float* min, const float* max);
+  void addBuffer(bgfx::ViewId view, BufferObject& bo, uint32_t vertices_count, uint32_t indices_count, uint64_t more_state);
+  void addModels(bgfx::ViewId view, BufferObject& bo, uint64_t more_state);
+  void addQuads(bgfx::ViewId view, BufferObject& bo, uint32_t quads_count, uint64_t more_state = 0);
+  void addCubes(bgfx::ViewId view, BufferObject& bo, uint32_t cubes_count, uint64_t more_state = 0);
+  void submit();
+  void encodeRun(bgfx::Encoder* encoder, const int run, const int runs_count);
+
+  uint32_t depth(const float* min, const float* max) const;
+  static Item dynamicItem(bgfx::ViewId view, BufferObject& bo, uint64_t more_state);
+  static bool batched(const Item& a, const Item& b);
+  static bool continues(const Item& a, const Item& b);
+  static void encode(bgfx::Encoder* encoder, const Item& item);
+  static void encodeJob(const int job, const int worker, void* user_data);
+};
+
+#endif
@@ -1,9 +1,10 @@
-$input a_position, a_color0, a_normal,  a_tangent, a_color1, a_bitangent,  a_color2, a_color3,  a_indices, a_weight
+$input a_position, a_color0, a_normal,  a_tangent, a_bitangent,  a_indices
 $output v_color0, v_normal0, v_position0
 
 #include <bgfx_shader.sh>
 
 uniform vec4 twh;
+uniform vec4 animation[64];
 uniform vec4 doors[21];
 
 void main()
@@ -11,15 +12,17 @@ void main()
   vec3 a_position2 = a_tangent;
   vec3 a_normal2 = a_bitangent;
 
-  vec3 pos1 = a_color2;
-  vec3 pos2 = a_color3;
+  // this model's record: placements then colours, their times in w
+  int object = int(a_indices.z) * 4;
+  vec4 pos1 = animation[object];
+  vec4 pos2 = animation[object + 1];
+  vec4 col1 = animation[object + 2];
+  vec4 col2 = animation[object + 3];
 
-  vec3 from_vcp = a_indices;
-  vec3 to_vcp = a_weight;
-
-  vec3 position = mix(a_position, a_position2, smoothstep(from_vcp.x, to_vcp.x, twh.x));
-  vec4 col = mix(a_color0, a_color1, smoothstep(from_vcp.y, to_vcp.y, twh.x));
-  vec3 pos = mix(pos1, pos2, smoothstep(from_vcp.z, to_vcp.z, twh.x));
+  vec3 position = mix(a_position, a_position2, smoothstep(a_indices.x, a_indices.y, twh.x));
+  vec3 tint = mix(col1.xyz, col2.xyz, smoothstep(col1.w, col2.w, twh.x));
+  vec4 col = vec4(clamp(a_color0.xyz + tint, 0.0, 1.0), a_color0.w);
+  vec3 pos = mix(pos1.xyz, pos2.xyz, smoothstep(pos1.w, pos2.w, twh.x));
 
 	gl_Position = mul(u_modelViewProj, vec4(position + pos, 1.0));
 	v_color0 = col;
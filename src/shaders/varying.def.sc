@@ -23,3 +23,6 @@ vec3 a_weight    : WEIGHT;
 
 vec2 a_texcoord0 : TEXCOORD0;
 vec2 a_texcoord1 : TEXCOORD1;
+
+vec4 i_data0     : TEXCOORD7;
+vec4 i_data1     : TEXCOORD6;
@@ -0,0 +1,282 @@
+#include "solver.hpp"
+#include <string.h>
+#include <algorithm>
+
+
+uint64_t Solver::zobrist(const Spot& spot)
+{
+  // splitmix64 of the packed spot, stable across runs and grid bounds
+  uint64_t z = ((uint64_t)(uint32_t)spot.x << 32) | (uint32_t)spot.y;
+  z += 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+
+uint64_t Solver::hash(const std::vector<Spot>& spots)
+{
+  // a sum rather than a xor, so two blocks on one cell don't cancel out
+  uint64_t h = 0;
+  fr(i, spots) {
+    h += zobrist(spots[i]);
+  }
+  return h;
+}
+
+
+void Solver::prepare(const WorldState& state)
+{
+  const Grid& grid = state.grid;
+  int cells_count = grid.width * grid.height;
+
+  blocks_count = state.moving_spots.size();
+  winning_total = state.winning_doors_spots.size();
+
+  for (int i = 0; i < 4; ++i) {
+    offsets[i] = directions[i].x + directions[i].y * grid.width;
+  }
+
+  floor_cells.resize(cells_count);
+  teleports.resize(cells_count);
+  winning_cells.resize(cells_count);
+  keys.resize(cells_count);
+
+  Spot spot;
+  for (int i = 0; i < cells_count; ++i) {
+    const Grid::Cell& cell = grid.cells[i];
+    floor_cells[i] = (cell.flags & Grid::floor_cell) != 0;
+    winning_cells[i] = cell.winning;
+    teleports[i] = cell.partner == -1 ? -1 : grid.index(state.doors_spots[cell.partner]);
+
+    spot.x = grid.min_x + i % grid.width;
+    spot.y = grid.min_y + i / grid.width;
+    keys[i] = zobrist(spot);
+  }
+
+  states.clear();
+  parents.clear();
+  moves.clear();
+  hashes.clear();
+  edges.clear();
+  table.assign(1 << 12, 0);
+  table_mask = table.size() - 1;
+}
+
+
+int Solver::insert(const uint16_t* cells, const uint64_t h, const int parent, const uint8_t move)
+{
+  uint32_t slot = (uint32_t)h & table_mask;
+
+  while (table[slot]) {
+    int node = table[slot] - 1;
+    if (hashes[node] == h &&
+        memcmp(&states[node * blocks_count], cells, blocks_count * sizeof(cells[0])) == 0) {
+      return node;
+    }
+    slot = (slot + 1) & table_mask;
+  }
+
+  int node = hashes.size();
+  table[slot] = node + 1;
+  states.insert(states.end(), cells, cells + blocks_count);
+  parents.push_back(parent);
+  moves.push_back(move);
+  hashes.push_back(h);
+
+  if (hashes.size() * 2 > table.size()) {
+    grow();
+  }
+
+  return node;
+}
+
+
+void Solver::grow()
+{
+  table.assign(table.size() * 2, 0);
+  table_mask = table.size() - 1;
+
+  fr(node, hashes) {
+    uint32_t slot = (uint32_t)hashes[node] & table_mask;
+    while (table[slot]) {
+      slot = (slot + 1) & table_mask;
+    }
+    table[slot] = node + 1;
+  }
+}
+
+
+bool Solver::won(const uint16_t* cells) const
+{
+  int winning_count = 0;
+
+  for (int i = 0; i < blocks_count; ++i) {
+    winning_count += winning_cells[cells[i]];
+  }
+
+  return winning_count > 0 && winning_count == winning_total;
+}
+
+
+void Solver::path(int node, std::string& solution) const
+{
+  solution.clear();
+
+  while (parents[node] != -1) {
+    solution.push_back(directions_chars[moves[node]]);
+    node = parents[node];
+  }
+
+  solution.assign(solution.rbegin(), solution.rend());
+}
+
+
+bool Solver::start(const WorldState& state)
+{
+  // spread out editor levels can outgrow the 16 bit cells, which would wrap
+  if (state.grid.width * state.grid.height > max_cells) {
+    return false;
+  }
+
+  prepare(state);
+
+  std::vector<uint16_t> cells(blocks_count);
+  uint64_t h = 0;
+
+  fr(i, state.moving_spots) {
+    int cell = state.grid.index(state.moving_spots[i]);
+    if (cell == -1) {
+      return false;
+    }
+    cells[i] = cell;
+    h += keys[cell];
+  }
+  std::sort(cells.begin(), cells.end());
+
+  insert(cells.data(), h, -1, 0);
+
+  return true;
+}
+
+
+bool Solver::step(const uint16_t* current, const uint64_t h, const int d, uint16_t* cells, uint64_t& next_h) const
+{
+  next_h = h;
+
+  for (int i = 0; i < blocks_count; ++i) {
+    int next = current[i] + offsets[d];
+    if (!floor_cells[next]) {
+      return false;
+    }
+    if (teleports[next] != -1) {
+      next = teleports[next];
+    }
+    cells[i] = next;
+    next_h += keys[next] - keys[current[i]];
+  }
+
+  // keep the block list canonical, counts are tiny
+  for (int i = 1; i < blocks_count; ++i) {
+    for (int j = i; j > 0 && cells[j - 1] > cells[j]; --j) {
+      std::swap(cells[j - 1], cells[j]);
+    }
+  }
+
+  return true;
+}
+
+
+Solver::Result Solver::solve(const WorldState& state)
+{
+  Result result;
+  result.solvable = false;
+  result.complete = true;
+  result.moves = -1;
+  result.explored = 0;
+
+  if (!start(state)) {
+    result.complete = false;
+    return result;
+  }
+
+  std::vector<uint16_t> cells(blocks_count);
+  std::vector<uint16_t> current(blocks_count);
+  uint64_t h;
+
+  for (int node = 0; node < (int)hashes.size(); ++node) {
+    // copied, inserting may move the states storage
+    std::copy(states.begin() + node * blocks_count, states.begin() + (node + 1) * blocks_count, current.begin());
+    result.explored = node + 1;
+
+    if (won(current.data())) {
+      result.solvable = true;
+      path(node, result.solution);
+      result.moves = result.solution.size();
+      return result;
+    }
+
+    if ((int)hashes.size() >= max_states) {
+      result.complete = false;
+      return result;
+    }
+
+    for (int d = 0; d < 4; ++d) {
+      if (step(current.data(), hashes[node], d, cells.data(), h)) {
+        insert(cells.data(), h, node, d);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+Solver::Result Solver::explore(const WorldState& state)
+{
+  Result result;
+  result.solvable = false;
+  result.complete = true;
+  result.moves = -1;
+  result.explored = 0;
+
+  if (!start(state)) {
+    result.complete = false;
+    return result;
+  }
+
+  std::vector<uint16_t> cells(blocks_count);
+  std::vector<uint16_t> current(blocks_count);
+  uint64_t h;
+
+  for (int node = 0; node < (int)hashes.size(); ++node) {
+    std::copy(states.begin() + node * blocks_count, states.begin() + (node + 1) * blocks_count, current.begin());
+    result.explored = node + 1;
+
+    // the game ends on a win, nothing leads out of a won state
+    if (won(current.data())) {
+      if (!result.solvable) {
+        result.solvable = true;
+        path(node, result.solution);
+        result.moves = result.solution.size();
+      }
+      edges.insert(edges.end(), 4, -1);
+      continue;
+    }
+
+    if ((int)hashes.size() >= max_states) {
+      result.complete = false;
+      return result;
+    }
+
+    for (int d = 0; d < 4; ++d) {
+      int child = -1;
+      if (step(current.data(), hashes[node], d, cells.data(), h)) {
+        child = insert(cells.data(), h, node, d);
+      }
+      edges.push_back(child);
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,66 @@
+#ifndef SOLVER
+#define SOLVER
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "world_state.hpp"
+
+// Breadth first search over moving block configurations, using the same
+// rules as WorldState::apply. Blocks are interchangeable, so a state is the
+// sorted list of their cells, keyed by an additive Zobrist hash. A level
+// the search can't start on comes back not complete.
+struct Solver
+{
+  struct Result
+  {
+    bool solvable;
+    bool complete;
+    int moves;
+    int explored;
+    std::string solution;
+  };
+
+  int max_states = 1 << 22;
+  // cells are stored in 16 bits, bigger grids are not searched
+  static const int max_cells = 1 << 16;
+
+  Result solve(const WorldState& state);
+
+  // every reachable state and its successors, for retrograde analysis
+  Result explore(const WorldState& state);
+
+  static uint64_t zobrist(const Spot& spot);
+  static uint64_t hash(const std::vector<Spot>& spots);
+
+
+  int blocks_count;
+  int winning_total;
+  int offsets[4];
+
+  std::vector<uint8_t> floor_cells;
+  std::vector<int> teleports;
+  std::vector<uint8_t> winning_cells;
+  std::vector<uint64_t> keys;
+
+  std::vector<uint16_t> states;
+  std::vector<int> parents;
+  std::vector<uint8_t> moves;
+  std::vector<uint64_t> hashes;
+  std::vector<uint32_t> table;
+  uint32_t table_mask;
+
+  // filled by explore: node * 4 + direction -> node, or -1 when blocked
+  std::vector<int> edges;
+
+  void prepare(const WorldState& state);
+  bool start(const WorldState& state);
+  bool step(const uint16_t* current, const uint64_t h, const int d, uint16_t* cells, uint64_t& next_h) const;
+  int insert(const uint16_t* cells, const uint64_t h, const int parent, const uint8_t move);
+  void grow();
+  bool won(const uint16_t* cells) const;
+  void path(int node, std::string& solution) const;
+};
+
+#endif
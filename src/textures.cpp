@@ -1,4 +1,5 @@
 #include "textures.hpp"
+#include "arena.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "../stb_image.h"
 
@@ -8,7 +9,10 @@ void Textures::prepare(const std::vector<std::string>& resources_pathnames)
 
   int width, height, nrChannels;
   unsigned char* image;
-  unsigned char* texture = new unsigned char[texture_size * texture_size * 4]{};
+  // staging, bgfx gets a copy and the arena has it back on return
+  Arena::Scope scope(Arena::run());
+  unsigned char* texture = Arena::run().alloc<unsigned char>(texture_size * texture_size * 4);
+  memset(texture, 0, texture_size * texture_size * 4);
 
   stbi_set_flip_vertically_on_load(true);
   mappings.reserve(resources_pathnames.size());
@@ -43,7 +47,7 @@ void Textures::prepare(const std::vector<std::string>& resources_pathnames)
     stbi_image_free(image);
   }
 
-  const bgfx::Memory *mem = bgfx::makeRef(texture, texture_size * texture_size * 4);
+  const bgfx::Memory *mem = bgfx::copy(texture, texture_size * texture_size * 4);
   texture_handle = bgfx::createTexture2D(
       texture_size,
       texture_size,
@@ -63,3 +67,10 @@ void Textures::setTexture()
     bgfx::setTexture(0, sampler_handle, texture_handle);
   }
 }
+
+void Textures::setTexture(bgfx::Encoder* encoder)
+{
+  if (armed) {
+    encoder->setTexture(0, sampler_handle, texture_handle);
+  }
+}
@@ -22,6 +22,7 @@ struct Textures
 
   void prepare(const std::vector<std::string>& resources_pathnames);
   void setTexture();
+  void setTexture(bgfx::Encoder* encoder);
 
   bool armed = false;
 };
@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <bgfx/bgfx.h>
+#include <bgfx/platform.h>
+#include <bx/timer.h>
+
+#include "../world.hpp"
+#include "../levels.hpp"
+#include "../nimate.hpp"
+
+// Throughput of the hot paths, on a headless Noop renderer so it runs
+// without a window. Every number is the best of three timed runs, each
+// repeating its batch for at least min_seconds. Run from the repo root,
+// it needs the compiled shaders in bin/ and the models in assets/. Debug
+// bgfx traces to stdout, so pass a file to keep the results clean. The
+// switch suite leaves a "<level>.baked" cache next to every level. Build
+// it with "make bench OPTFLAGS=-O2" for timings, unoptimised builds leave
+// out the simd kernels and the expand suite reports the scalar loop only.
+//
+//   ./bench [--json] [file]     csv, or json, on stdout or into file
+
+static const double min_seconds = 0.1;
+static const int trials = 3;
+static const int resolve_moves = 10000;
+static const int playout_length = 200;
+static const int nimate_frames = 60;
+static const int nimate_tracks[] = {10, 100, 1000};
+
+struct Result
+{
+  std::string suite;
+  std::string name;
+  std::string metric;
+  double value;
+};
+
+World world;
+std::vector<Level> levels;
+std::vector<Result> results;
+
+double seconds(const int64_t start)
+{
+  return double(bx::getHPCounter() - start) / bx::getHPFrequency();
+}
+
+// fn runs one batch and returns the work it did, the best rate wins
+template<typename Fn>
+double measure(Fn fn)
+{
+  double best = 0.0;
+
+  for (int t = 0; t < trials; ++t) {
+    double work = 0.0;
+    int64_t start = bx::getHPCounter();
+
+    do {
+      work += fn();
+    } while (seconds(start) < min_seconds);
+
+    double rate = work / seconds(start);
+    if (rate > best) {
+      best = rate;
+    }
+  }
+
+  return best;
+}
+
+void report(const char* suite, const std::string& name, const char* metric, const double value)
+{
+  results.push_back(Result{suite, name, metric, value});
+  fprintf(stderr, "%-10s %-40s %-14s %14.2f\n", suite, name.c_str(), metric, value);
+}
+
+void loadLevel(const Level& level)
+{
+  char level_str[255];
+  Levels::path(level_str, level);
+  Levels::load(level_str, world.state);
+  world.init();
+}
+
+void benchResolve()
+{
+  char label_str[255];
+  uint32_t seed = 1;
+
+  fr(l, levels) {
+    loadLevel(levels[l]);
+
+    double rate = measure([&]() {
+      for (int i = 0; i < resolve_moves; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        world.resolve(directions[seed >> 30], false, false, false);
+
+        if (world.won || i % playout_length == playout_length - 1) {
+          world.won = false;
+          world.state.reset();
+        }
+      }
+      return (double)resolve_moves;
+    });
+
+    Levels::label(label_str, levels[l]);
+    report("resolve", label_str, "moves_per_s", rate);
+  }
+}
+
+// bytes one writeModelsVertices call leaves in the buffer
+double writtenBytes(const BufferObject& bo)
+{
+  if (bo.instanced) {
+    return bo.instances.size() * sizeof(InstanceData);
+  }
+  double vertex_size = sizeof(PackedPosColorTexVertex) + (bo.animations ? sizeof(AnimationVertex) : 0);
+  return bo.models_vertices_count * vertex_size + bo.models_indices_count * bo.indexSize();
+}
+
+void benchWriteModels()
+{
+  struct Buffer
+  {
+    const char* name;
+    BufferObject* bo;
+    std::vector<bx::Vec3>* positions;
+    std::vector<bx::Vec3>* colors;
+    std::vector<int>* models_list;
+  };
+
+  Buffer buffers[] = {
+    {"moving", &world.moving_bo, &world.moving_positions, &world.moving_colors, &world.moving_models_list},
+    {"static", &world.static_bo, &world.static_positions, &world.static_colors, &world.state.static_models_list},
+    {"doors", &world.doors_bo, &world.doors_positions, &world.doors_colors, &world.doors_models_list},
+    {"winning_doors", &world.winning_doors_bo, &world.winning_doors_positions, &world.winning_doors_colors, &world.winning_doors_models_list},
+    {"floor", &world.floor_bo, &world.floor_positions, &world.floor_colors, &world.state.floor_models_list},
+    {"bg", &world.bg_bo, &world.bg_positions, &world.bg_colors, &world.bg_models_list},
+  };
+
+  // every level in turn, so the rate covers the whole level set
+  for (int b = 0; b < (int)BX_COUNTOF(buffers); ++b) {
+    Buffer& buffer = buffers[b];
+    double bytes = 0.0;
+    double elapsed = 0.0;
+
+    fr(l, levels) {
+      loadLevel(levels[l]);
+      if (buffer.positions->empty()) {
+        continue;
+      }
+
+      double rate = measure([&]() {
+        world.writeModelsVertices(*buffer.bo, *buffer.positions, *buffer.colors, *buffer.models_list);
+        return writtenBytes(*buffer.bo);
+      });
+
+      bytes += writtenBytes(*buffer.bo);
+      elapsed += writtenBytes(*buffer.bo) / rate;
+    }
+
+    report("write", buffer.name, "mb_per_s", elapsed > 0.0 ? bytes / elapsed / (1024.0 * 1024.0) : 0.0);
+    report("write", buffer.name, "kb_all_levels", bytes / 1024.0);
+  }
+}
+
+// the static layer's meshes into packed vertices, the simd kernel against
+// the scalar one it falls back to
+void benchExpand()
+{
+  const Models& models = world.static_bo.models;
+  std::vector<PackedPosColorTexVertex> packed(models.vertices_count);
+  bx::Vec3 pos(1.0f, 0.0f, 2.0f);
+  bx::Vec3 col(0.1f, 0.1f, 0.1f);
+
+  auto expandAll = [&](const bool simd) {
+    double bytes = 0.0;
+    for (int nth = 0; nth < models.models_count; ++nth) {
+      int count = models.nth_model_vertices_count(nth);
+      PackedPosColorTexVertex* dst = &packed[models.vertices_offsets[nth]];
+      const PosColorTexVertex* src = &models.vertices[models.vertices_offsets[nth]];
+      if (simd) {
+        BufferObject::expandModel(dst, src, count, pos, col);
+      } else {
+        BufferObject::expandModelScalar(dst, src, count, pos, col);
+      }
+      bytes += count * sizeof(PackedPosColorTexVertex);
+    }
+    return bytes;
+  };
+
+  double scalar = measure([&]() { return expandAll(false); });
+  report("expand", "scalar", "mb_per_s", scalar / (1024.0 * 1024.0));
+
+  // without the kernel expandModel is the scalar loop, nothing to compare
+  if (!BufferObject::expand_simd) {
+    return;
+  }
+
+  double simd = measure([&]() { return expandAll(true); });
+  report("expand", "simd", "mb_per_s", simd / (1024.0 * 1024.0));
+  report("expand", "simd", "speedup", simd / scalar);
+}
+
+void benchNimate()
+{
+  // a plain models buffer of cubes, like the moving blocks Nimate drives
+  BufferObject bo;
+  bo.initAnimatedModels(1000);
+  bo.createBuffers();
+  bo.models.init();
+  bo.models.import("cube.obj", 0);
+
+  for (int n = 0; n < (int)BX_COUNTOF(nimate_tracks); ++n) {
+    int tracks = nimate_tracks[n];
+
+    std::vector<bx::Vec3> positions(tracks);
+    std::vector<bx::Vec3> colors(tracks, bx::Vec3(0.5f, 0.5f, 0.5f));
+    std::vector<int> models(tracks, 0);
+    std::vector<int> flags(tracks, 0);
+
+    fr(i, positions) {
+      positions[i] = bx::Vec3(float(i % 32), 0.0f, float(i / 32));
+    }
+
+    Nimate nimate;
+    nimate.prepare(&world, &bo, &positions, &colors, &models, &flags);
+    nimate.init();
+
+    float t = 0.0f;
+    double rate = measure([&]() {
+      // every track jumps each frame so every run rewrites its records,
+      // with a frame per run like the game as bgfx queues each update
+      for (int f = 0; f < nimate_frames; ++f) {
+        fr(i, positions) {
+          nimate.schedule_position(i, bx::Vec3(float(f % 2), 0.0f, positions[i].z), t, t);
+        }
+        nimate.run(t);
+        bgfx::frame();
+        t += 1000.0f / 60.0f;
+      }
+      return (double)nimate_frames;
+    });
+
+    char name[32];
+    sprintf(name, "tracks_%d", tracks);
+    report("nimate", name, "runs_per_s", rate);
+  }
+
+  bgfx::destroy(bo.m_vbh);
+  bgfx::destroy(bo.m_abh);
+  bgfx::destroy(bo.m_ibh);
+  bgfx::destroy(bo.u_animation);
+}
+
+void benchLoad()
+{
+  char level_str[255];
+  char label_str[255];
+
+  fr(l, levels) {
+    Levels::path(level_str, levels[l]);
+
+    double rate = measure([&]() {
+      WorldState state;
+      Levels::load(level_str, state);
+      return 1.0;
+    });
+
+    Levels::label(label_str, levels[l]);
+    report("load", label_str, "ms", 1000.0 / rate);
+  }
+}
+
+// a whole level switch, static layers rebuilt and then from the level's cache
+void benchSwitch()
+{
+  char level_str[255];
+  char label_str[255];
+
+  fr(l, levels) {
+    Levels::path(level_str, levels[l]);
+    Levels::label(label_str, levels[l]);
+
+    world.baked_str[0] = '\0';
+    world.level_hash = 0;
+    double rate = measure([&]() {
+      loadLevel(levels[l]);
+      world.bake();
+      bgfx::frame();
+      return 1.0;
+    });
+    report("switch", label_str, "ms_rebuilt", 1000.0 / rate);
+
+    world.loadBaked(level_str);
+    loadLevel(levels[l]);
+    world.bake();
+
+    rate = measure([&]() {
+      world.loadBaked(level_str);
+      loadLevel(levels[l]);
+      world.bake();
+      bgfx::frame();
+      return 1.0;
+    });
+    report("switch", label_str, "ms_cached", 1000.0 / rate);
+  }
+
+  world.baked_str[0] = '\0';
+  world.level_hash = 0;
+}
+
+void printCsv(FILE* out)
+{
+  fprintf(out, "suite,name,metric,value\n");
+  fr(i, results) {
+    fprintf(out, "%s,\"%s\",%s,%.3f\n",
+        results[i].suite.c_str(), results[i].name.c_str(), results[i].metric.c_str(), results[i].value);
+  }
+}
+
+void printJson(FILE* out)
+{
+  fprintf(out, "[\n");
+  fr(i, results) {
+    fprintf(out, "  {\"suite\": \"%s\", \"name\": \"%s\", \"metric\": \"%s\", \"value\": %.3f}%s\n",
+        results[i].suite.c_str(), results[i].name.c_str(), results[i].metric.c_str(), results[i].value,
+        i + 1 < (int)results.size() ? "," : "");
+  }
+  fprintf(out, "]\n");
+}
+
+int main(int argc, char* argv[])
+{
+  bool json = false;
+  const char* out_str = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else {
+      out_str = argv[i];
+    }
+  }
+
+  FILE* out = out_str ? fopen(out_str, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "cannot write %s\n", out_str);
+    return 1;
+  }
+
+  // single threaded like the game, and no window behind the Noop renderer
+  bgfx::renderFrame();
+
+  bgfx::Init init;
+  init.type = bgfx::RendererType::Noop;
+  init.resolution.width = 1600;
+  init.resolution.height = 1000;
+  bgfx::init(init);
+
+  Levels::loadList(levels);
+  world.prepare();
+
+  benchResolve();
+  benchWriteModels();
+  benchExpand();
+  benchNimate();
+  benchLoad();
+  benchSwitch();
+
+  if (json) {
+    printJson(out);
+  } else {
+    printCsv(out);
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  world.destroy();
+  bgfx::shutdown();
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include <bx/timer.h>
+
+#include "../world_state.hpp"
+#include "../levels.hpp"
+#include "../generator.hpp"
+#include "../job_pool.hpp"
+
+// Mutates a level on all cores and writes the best distinct candidates next
+// to it as "<level>-gen-<key>", loadable like any other level. Add the ones
+// worth keeping to levels/levels_list by hand.
+//
+//   ./generate <level> [candidates] [min moves] [max moves] [keep] [threads]
+
+struct Generation
+{
+  WorldState base;
+  uint32_t seed;
+  std::vector<Generator> generators;
+  std::vector<std::vector<Generator::Candidate>> accepted;
+};
+
+void generateCandidate(const int job, const int worker, void* user_data)
+{
+  Generation* generation = (Generation*)user_data;
+  Generator::Candidate candidate;
+
+  if (generation->generators[worker].generate(generation->base, generation->seed + job * 0x9e3779b9u, candidate)) {
+    generation->accepted[worker].push_back(candidate);
+  }
+}
+
+bool longer(const Generator::Candidate* a, const Generator::Candidate* b)
+{
+  if (a->result.moves != b->result.moves) {
+    return a->result.moves > b->result.moves;
+  }
+  return a->key < b->key;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    printf("usage: %s <level> [candidates] [min moves] [max moves] [keep] [threads]\n", argv[0]);
+    return 1;
+  }
+
+  int candidates_count = argc > 2 ? atoi(argv[2]) : 10000;
+  int keep = argc > 5 ? atoi(argv[5]) : 10;
+
+  Generation generation;
+  Levels::load(argv[1], generation.base);
+  generation.seed = (uint32_t)bx::getHPCounter();
+
+  JobPool pool;
+  pool.init(argc > 6 ? atoi(argv[6]) : 0);
+
+  generation.generators.resize(pool.workers_count);
+  generation.accepted.resize(pool.workers_count);
+  fr(i, generation.generators) {
+    if (argc > 3) generation.generators[i].min_moves = atoi(argv[3]);
+    if (argc > 4) generation.generators[i].max_moves = atoi(argv[4]);
+  }
+
+  int64_t start = bx::getHPCounter();
+  pool.run(candidates_count, generateCandidate, &generation);
+  double elapsed = double(bx::getHPCounter() - start) / bx::getHPFrequency();
+
+  pool.shutdown();
+
+  std::vector<const Generator::Candidate*> sorted;
+  fr(w, generation.accepted) {
+    fr(i, generation.accepted[w]) {
+      sorted.push_back(&generation.accepted[w][i]);
+    }
+  }
+  std::sort(sorted.begin(), sorted.end(), longer);
+
+  printf("%d candidates, %d accepted, %d threads, %.0f candidates/s\n\n",
+      candidates_count, (int)sorted.size(), pool.workers_count, candidates_count / elapsed);
+  printf("%-50s %6s %10s  %s\n", "level", "moves", "explored", "solution");
+
+  char level_str[255];
+  int written = 0;
+
+  fr(i, sorted) {
+    if (written == keep) {
+      break;
+    }
+
+    // mutations often land on the same layout, keep one of each
+    if (i > 0 && sorted[i]->key == sorted[i - 1]->key) {
+      continue;
+    }
+
+    Generator::Candidate candidate = *sorted[i];
+    sprintf(level_str, "%s-gen-%08x", argv[1], (uint32_t)candidate.key);
+    Levels::save(level_str, candidate.state);
+    written += 1;
+
+    printf("%-50s %6d %10d  %s\n",
+        level_str, candidate.result.moves, candidate.result.explored, candidate.result.solution.c_str());
+  }
+
+  return 0;
+}
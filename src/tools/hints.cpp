@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "../world_state.hpp"
+#include "../levels.hpp"
+#include "../solver.hpp"
+#include "../hints.hpp"
+
+// Writes "<level>.hints" next to each level, then plays the level by
+// following its own hints through WorldState::apply to check them.
+//
+//   ./hints                 every level in levels/levels_list
+//   ./hints <level>...      just the given level files
+
+bool verify(WorldState& state, const Hints& hints, int& distance)
+{
+  int move;
+
+  if (!hints.lookup(state.moving_spots, distance, move)) {
+    distance = -1;
+    return false;
+  }
+
+  for (int i = 0; i < distance; ++i) {
+    int left;
+    if (!hints.lookup(state.moving_spots, left, move) || left != distance - i) {
+      return false;
+    }
+    state.apply(directions[move]);
+  }
+
+  return state.isWon();
+}
+
+void buildHints(const char* filename, const char* label, Solver& solver)
+{
+  WorldState state;
+  state.prepare();
+  Levels::load(filename, state);
+  state.init();
+
+  auto start = std::chrono::steady_clock::now();
+  Hints hints;
+  bool complete = hints.build(state, solver);
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+  int distance = -1;
+  const char* status = "written";
+
+  if (!complete) {
+    status = "TOO BIG";
+  } else {
+    char hints_str[255];
+    Hints::path(hints_str, filename);
+    Hints::save(hints_str, hints);
+
+    if (!Hints::load(hints_str, state, hints)) {
+      status = "UNREADABLE";
+    } else if (!verify(state, hints, distance)) {
+      status = distance == -1 ? "UNSOLVABLE" : "MISMATCH";
+    }
+  }
+
+  printf("%-40s %-10s %6d %10d %10d %10.2f\n",
+      label, status, distance, (int)solver.hashes.size(), (int)hints.keys.size() * 10 / 1024, elapsed.count());
+}
+
+int main(int argc, char* argv[])
+{
+  Solver solver;
+  char level_str[255];
+  char label_str[255];
+
+  printf("%-40s %-10s %6s %10s %10s %10s\n", "level", "status", "moves", "states", "KiB", "ms");
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      buildHints(argv[i], argv[i], solver);
+    }
+    return 0;
+  }
+
+  std::vector<Level> levels;
+  Levels::loadList(levels);
+
+  fr(i, levels) {
+    Levels::path(level_str, levels[i]);
+    Levels::label(label_str, levels[i]);
+    buildHints(level_str, label_str, solver);
+  }
+
+  return 0;
+}
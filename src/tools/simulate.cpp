@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "../world_state.hpp"
+#include "../levels.hpp"
+
+// Headless rules runner, needs neither a display nor bgfx.
+//
+//   ./simulate                     random playouts over every listed level
+//   ./simulate <level> <moves>     replay a move string (l, r, u, d, z = undo)
+
+static const int playout_moves = 1000000;
+static const int playout_length = 200;
+
+Spot moveFromChar(const char c)
+{
+  for (int i = 0; i < 4; ++i) {
+    if (directions_chars[i] == c) {
+      return directions[i];
+    }
+  }
+
+  return Spot{0, 0};
+}
+
+int replay(const char* filename, const char* moves)
+{
+  WorldState state;
+  state.prepare();
+  Levels::load(filename, state);
+  state.init();
+
+  for (const char* c = moves; *c; ++c) {
+    if (*c == 'z') {
+      state.undo();
+    } else {
+      state.apply(moveFromChar(*c));
+    }
+
+    if (state.isWon()) {
+      printf("won after %d moves\n", (int)(c - moves) + 1);
+      return 0;
+    }
+  }
+
+  fr(i, state.moving_spots) {
+    printf("%d %d\n", state.moving_spots[i].x, state.moving_spots[i].y);
+  }
+  printf("not won\n");
+
+  return 1;
+}
+
+int playouts()
+{
+  std::vector<Level> levels;
+  Levels::loadList(levels);
+
+  char level_str[255];
+  char label_str[255];
+  uint32_t seed = 1;
+
+  printf("%-40s %12s %12s\n", "level", "moves/s", "wins");
+
+  fr(l, levels) {
+    WorldState state;
+    state.prepare();
+    Levels::path(level_str, levels[l]);
+    Levels::load(level_str, state);
+    state.init();
+
+    int wins = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < playout_moves; ++i) {
+      seed = seed * 1664525u + 1013904223u;
+      state.apply(directions[seed >> 30]);
+
+      if (state.isWon() || i % playout_length == playout_length - 1) {
+        wins += state.isWon();
+        state.reset();
+      }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    Levels::label(label_str, levels[l]);
+    printf("%-40s %12.0f %12d\n", label_str, playout_moves / elapsed.count(), wins);
+  }
+
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc == 3) {
+    return replay(argv[1], argv[2]);
+  }
+
+  return playouts();
+}
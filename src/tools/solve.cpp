@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "../world_state.hpp"
+#include "../levels.hpp"
+#include "../solver.hpp"
+
+// Solves levels with the rules core and replays every solution through
+// WorldState::apply to make sure both agree.
+//
+//   ./solve                 every level in levels/levels_list
+//   ./solve <level>...      just the given level files
+
+bool verify(WorldState& state, const std::string& solution)
+{
+  fr(i, solution) {
+    for (int d = 0; d < 4; ++d) {
+      if (directions_chars[d] == solution[i] && !state.apply(directions[d])) {
+        return false;
+      }
+    }
+  }
+
+  return state.isWon();
+}
+
+void solveLevel(const char* filename, const char* label, Solver& solver)
+{
+  WorldState state;
+  state.prepare();
+  Levels::load(filename, state);
+  state.init();
+
+  auto start = std::chrono::steady_clock::now();
+  Solver::Result result = solver.solve(state);
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+  const char* status = result.solvable ? "solvable" : (result.complete ? "UNSOLVABLE" : "UNKNOWN");
+  if (result.solvable && !verify(state, result.solution)) {
+    status = "MISMATCH";
+  }
+
+  printf("%-40s %-10s %6d %10d %10.2f  %s\n",
+      label, status, result.moves, result.explored, elapsed.count(), result.solution.c_str());
+}
+
+int main(int argc, char* argv[])
+{
+  Solver solver;
+  char level_str[255];
+  char label_str[255];
+
+  printf("%-40s %-10s %6s %10s %10s  %s\n", "level", "status", "moves", "explored", "ms", "solution");
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      solveLevel(argv[i], argv[i], solver);
+    }
+    return 0;
+  }
+
+  std::vector<Level> levels;
+  Levels::loadList(levels);
+
+  fr(i, levels) {
+    Levels::path(level_str, levels[i]);
+    Levels::label(label_str, levels[i]);
+    solveLevel(level_str, label_str, solver);
+  }
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <bx/timer.h>
+
+#include "../world_state.hpp"
+#include "../levels.hpp"
+#include "../solver.hpp"
+#include "../job_pool.hpp"
+
+// Solves every level in levels/levels_list on all cores and prints a table,
+// exits with 1 when any level is unsolvable or ran out of states.
+//
+//   ./validate [threads]
+
+struct Validation
+{
+  std::vector<Level> levels;
+  std::vector<Solver> solvers;
+  std::vector<Solver::Result> results;
+  std::vector<double> times;
+};
+
+void validateLevel(const int job, const int worker, void* user_data)
+{
+  Validation* validation = (Validation*)user_data;
+  char level_str[255];
+
+  int64_t start = bx::getHPCounter();
+
+  WorldState state;
+  state.prepare();
+  Levels::path(level_str, validation->levels[job]);
+  Levels::load(level_str, state);
+  state.init();
+
+  validation->results[job] = validation->solvers[worker].solve(state);
+  validation->times[job] = (bx::getHPCounter() - start) * 1000.0 / bx::getHPFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+  Validation validation;
+  Levels::loadList(validation.levels);
+
+  JobPool pool;
+  pool.init(argc > 1 ? atoi(argv[1]) : 0);
+
+  validation.solvers.resize(pool.workers_count);
+  validation.results.resize(validation.levels.size());
+  validation.times.resize(validation.levels.size());
+
+  int64_t start = bx::getHPCounter();
+  pool.run(validation.levels.size(), validateLevel, &validation);
+  double total = (bx::getHPCounter() - start) * 1000.0 / bx::getHPFrequency();
+
+  pool.shutdown();
+
+  char label_str[255];
+  int failed = 0;
+
+  printf("%-40s %-10s %6s %10s %10s\n", "level", "status", "moves", "explored", "ms");
+
+  fr(i, validation.levels) {
+    const Solver::Result& result = validation.results[i];
+    const char* status = result.solvable ? "solvable" : (result.complete ? "UNSOLVABLE" : "UNKNOWN");
+    failed += !result.solvable;
+
+    Levels::label(label_str, validation.levels[i]);
+    printf("%-40s %-10s %6d %10d %10.2f\n", label_str, status, result.moves, result.explored, validation.times[i]);
+  }
+
+  printf("\n%d levels, %d failed, %d threads, %.2f ms\n",
+      (int)validation.levels.size(), failed, pool.workers_count, total);
+
+  return failed > 0;
+}
@@ -0,0 +1,111 @@
+#include "undo_log.hpp"
+
+#include <assert.h>
+
+
+void UndoLog::init(const int capacity)
+{
+  // a power of two keeps indexing right when the counters wrap
+  int size = 2;
+  while (size < capacity) {
+    size *= 2;
+  }
+
+  data.resize(size);
+  clear();
+}
+
+
+void UndoLog::clear()
+{
+  head = 0;
+  tail = 0;
+}
+
+
+bool UndoLog::empty() const
+{
+  return head == tail;
+}
+
+
+void UndoLog::push(const int direction, const std::vector<int>& blocks, const std::vector<int>& doors)
+{
+  // the header only has two bits for it, see WorldState::direction
+  assert(direction >= 0 && direction < 4);
+
+  uint32_t size = 2 + 2 * blocks.size();
+
+  if (size > data.size()) {
+    // one move bigger than the whole ring, grow it rather than lose the history
+    grow(size);
+  }
+
+  while (head - tail + size > data.size()) {
+    dropOldest();
+  }
+
+  uint16_t header = direction | (blocks.size() << 2);
+
+  at(head++) = header;
+  for (int i = 0; i < (int)blocks.size(); ++i) {
+    at(head++) = blocks[i];
+    at(head++) = doors[i];
+  }
+  at(head++) = header;
+}
+
+
+bool UndoLog::pop(int& direction, std::vector<int>& blocks, std::vector<int>& doors)
+{
+  if (empty()) {
+    return false;
+  }
+
+  uint16_t header = at(head - 1);
+  int count = header >> 2;
+
+  direction = header & 3;
+  blocks.resize(count);
+  doors.resize(count);
+
+  head -= 2 + 2 * count;
+  for (int i = 0; i < count; ++i) {
+    blocks[i] = at(head + 1 + 2 * i);
+    doors[i] = at(head + 2 + 2 * i);
+  }
+
+  return true;
+}
+
+
+uint16_t& UndoLog::at(const uint32_t i)
+{
+  return data[i & (data.size() - 1)];
+}
+
+
+void UndoLog::grow(const uint32_t capacity)
+{
+  uint32_t size = data.size();
+  while (size < capacity) {
+    size *= 2;
+  }
+
+  // unwrap the ring so the entries start at zero again
+  uint32_t count = head - tail;
+  std::vector<uint16_t> grown(size);
+  for (uint32_t i = 0; i < count; ++i) {
+    grown[i] = at(tail + i);
+  }
+
+  data.swap(grown);
+  tail = 0;
+  head = count;
+}
+
+
+void UndoLog::dropOldest()
+{
+  tail += 2 + 2 * (at(tail) >> 2);
+}
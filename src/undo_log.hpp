@@ -0,0 +1,34 @@
+#ifndef UNDO_LOG
+#define UNDO_LOG
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Bounded move history in a flat ring of 16 bit words. A move is stored as
+// its direction plus the (block, door) pairs that went through a door:
+//
+//   [header] [block door]... [header],  header = direction | teleports << 2
+//
+// The header at both ends lets pop read from the head and the oldest entry
+// be dropped from the tail once the ring is full. A single move that does
+// not fit at all grows the ring instead.
+struct UndoLog
+{
+  std::vector<uint16_t> data;
+  uint32_t head;
+  uint32_t tail;
+
+  void init(const int capacity);
+  void clear();
+  bool empty() const;
+
+  void push(const int direction, const std::vector<int>& blocks, const std::vector<int>& doors);
+  bool pop(int& direction, std::vector<int>& blocks, std::vector<int>& doors);
+
+  uint16_t& at(const uint32_t i);
+  void grow(const uint32_t capacity);
+  void dropOldest();
+};
+
+#endif
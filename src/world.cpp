@@ -1,4 +1,5 @@
 #include "world.hpp"
+#include "arena.hpp"
 #include <cmath>
 
 
@@ -120,24 +121,34 @@ void gen_quads_with_edges(
 }
 
 
+uint64_t hashBytes(uint64_t h, const void* data, const size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; ++i) {
+    h = (h ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return h;
+}
+
+
+template<typename T>
+uint64_t hashVector(uint64_t h, const std::vector<T>& v)
+{
+  h = (h ^ v.size()) * 0x100000001b3ull;
+  return hashBytes(h, v.data(), v.size() * sizeof(T));
+}
+
+
 void World::prepare()
 {
-  moving_spots.reserve(100);
+  state.prepare();
+
   moving_clones_spots.reserve(100);
-  moving_next_spots.reserve(100);
-  moving_intermediate_spots.reserve(100);
-  static_spots.reserve(1000);
-  doors_spots.reserve(1000);
-  winning_doors_spots.reserve(100);
   editor_spot.reserve(1);
   editor_spot.resize(1);
   through_door.reserve(100);
   empty_flags.reserve(1);
   empty_flags.resize(0);
-  floor_spots.reserve(1000);
-
-  all_moving_spots.reserve(1000);
-  all_any_through_doors.reserve(1000);
 
   moving_positions.reserve(100);
   moving_clones_positions.reserve(100);
@@ -158,21 +169,37 @@ void World::prepare()
   colors_temp.reserve(100);
   models_temp.reserve(100);
 
-  AnimatedPosColorTexVertex::init();
-
-  moving_bo.initModels(5);
-  moving_clones_bo.initModels(5);
-  static_bo.initModels(1000);
+  PackedPosColorTexVertex::init();
+  AnimationVertex::init();
+  InstanceData::init();
+
+  // placed models share one mesh copy when the renderer can instance
+  bool instancing = bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING;
+
+  // rewritten every animated frame and only a few cubes, copied tight into
+  // bgfx's per frame buffers instead of living in oversized dynamic ones
+  moving_bo.initAnimatedModels(5);
+  moving_bo.transient = true;
+  moving_clones_bo.initAnimatedModels(5);
+  moving_clones_bo.transient = true;
+  if (instancing) {
+    static_bo.initInstanced(1000);
+  } else {
+    static_bo.initModels(1000);
+  }
   doors_bo.initModels(20);
   winning_doors_bo.initModels(10);
   tiles_bo.initQuads(1000);
   editor_bo.initCubes(1);
   quads_bo.initQuads(1000);
-  floor_bo.initModels(100);
+  if (instancing) {
+    floor_bo.initInstanced(1000);
+  } else {
+    floor_bo.initModels(100);
+  }
   bg_bo.initModels(1);
 
 
-  bgfx::ShaderHandle v_animated_tex = Common::loadShader("bin/v_animated_tex.bin");
   bgfx::ShaderHandle f_animated_tex = Common::loadShader("bin/f_animated_tex.bin");
   bgfx::ShaderHandle v_simple = Common::loadShader("bin/v_simple.bin");
   bgfx::ShaderHandle f_simple = Common::loadShader("bin/f_simple.bin");
@@ -186,8 +213,9 @@ void World::prepare()
   bgfx::ShaderHandle f_tex = Common::loadShader("bin/f_tex.bin");
   bgfx::ShaderHandle f_editor = Common::loadShader("bin/f_editor.bin");
   bgfx::ShaderHandle f_bg = Common::loadShader("bin/f_bg.bin");
+  bgfx::ShaderHandle v_instanced_tex = Common::loadShader("bin/v_instanced_tex.bin");
+  bgfx::ShaderHandle v_static_tex = Common::loadShader("bin/v_static_tex.bin");
 
-  bgfx::ProgramHandle p_animated_tex = bgfx::createProgram(v_animated_tex, f_animated_tex, false);
   bgfx::ProgramHandle p_animated_simple = bgfx::createProgram(v_animated_simple, f_simple, false);
   bgfx::ProgramHandle p_animated_simple_doors_in = bgfx::createProgram(v_animated_simple, f_simple_doors_in, false);
   bgfx::ProgramHandle p_animated_simple_doors_out = bgfx::createProgram(v_animated_simple, f_simple_doors_out, false);
@@ -195,16 +223,18 @@ void World::prepare()
   bgfx::ProgramHandle p_tex = bgfx::createProgram(v_tex, f_tex, false);
   bgfx::ProgramHandle p_noise_simple = bgfx::createProgram(v_simple, f_noise_simple, false);
   bgfx::ProgramHandle p_editor = bgfx::createProgram(v_simple, f_editor, false);
-  bgfx::ProgramHandle p_bg = bgfx::createProgram(v_animated_tex, f_bg, false);
+  bgfx::ProgramHandle p_static_tex = bgfx::createProgram(v_static_tex, f_animated_tex, false);
+  bgfx::ProgramHandle p_bg = bgfx::createProgram(v_static_tex, f_bg, false);
+  bgfx::ProgramHandle p_instanced_tex = bgfx::createProgram(v_instanced_tex, f_animated_tex, false);
 
   moving_bo.createBuffers();
   moving_bo.m_program = p_animated_simple_doors_in;
   moving_clones_bo.createBuffers();
   moving_clones_bo.m_program = p_animated_simple_doors_out;
   static_bo.createBuffers();
-  static_bo.m_program = p_animated_tex;
+  static_bo.m_program = instancing ? p_instanced_tex : p_static_tex;
   doors_bo.createBuffers();
-  doors_bo.m_program = p_animated_tex;
+  doors_bo.m_program = p_static_tex;
   winning_doors_bo.createBuffers();
   winning_doors_bo.m_program = p_noise_simple;
   tiles_bo.createBuffers();
@@ -214,7 +244,7 @@ void World::prepare()
   quads_bo.createBuffers();
   quads_bo.m_program = p_tex;
   floor_bo.createBuffers();
-  floor_bo.m_program = p_animated_tex;
+  floor_bo.m_program = instancing ? p_instanced_tex : p_static_tex;
   bg_bo.createBuffers();
   bg_bo.m_program = p_bg;
 
@@ -326,6 +356,9 @@ void World::prepare()
 
   floor_bo.models.init();
   floor_bo.models.set(vertices, colors, normals, uvs, indices, 0);
+  if (floor_bo.instanced) {
+    floor_bo.writeMeshes();
+  }
 
 
   std::vector<bx::Vec3> points;
@@ -366,6 +399,9 @@ void World::prepare()
   static_bo.models.import("test.obj", 1);
   static_bo.models.import("test-keyframe2.obj", 2);
   static_bo.models.import("cube.obj", 3);
+  if (static_bo.instanced) {
+    static_bo.writeMeshes();
+  }
 
   //
   // vertices[0] = bx::Vec3( 1.0f, -1.0f, -1.0f);
@@ -446,54 +482,85 @@ void World::prepare()
   winning_doors_bo.models.init();
   winning_doors_bo.models.set(vertices, colors, normals, uvs, indices, 0);
 
-  static_models_list.reserve(1000);
+  state.static_models_list.reserve(1000);
   moving_models_list.reserve(100);
-  floor_models_list.reserve(100);
+  state.floor_models_list.reserve(100);
   bg_models_list.reserve(1);
   doors_models_list.reserve(100);
 
   moving_nimate.prepare(this, &moving_bo, &moving_positions, &moving_colors, &moving_models_list, &through_door);
   moving_clones_nimate.prepare(this, &moving_clones_bo, &moving_clones_positions, &moving_colors, &moving_models_list, &empty_flags);
+
+  // the baked layers' meshes, tile atlas and vertex formats, fixed from here on
+  BufferObject* layers[] = {&static_bo, &doors_bo, &winning_doors_bo, &tiles_bo, &floor_bo, &bg_bo};
+  models_hash = 0xcbf29ce484222325ull ^ sizeof(PackedPosColorTexVertex) ^ sizeof(InstanceData) << 8;
+  float chunking[] = {Chunking::chunk_size, Chunking::object_reach, Chunking::min_y, Chunking::max_y};
+  models_hash = hashBytes(models_hash, chunking, sizeof(chunking));
+  for (int l = 0; l < (int)BX_COUNTOF(layers); ++l) {
+    const Models& models = layers[l]->models;
+    models_hash = (models_hash ^ layers[l]->instanced ^ layers[l]->index32 << 1 ^ models.models_count << 2) * 0x100000001b3ull;
+    if (models.models_count == 0) {
+      continue;
+    }
+    models_hash = hashBytes(models_hash, models.vertices_offsets, (models.models_count + 1) * sizeof(models.vertices_offsets[0]));
+    models_hash = hashBytes(models_hash, models.indices_offsets, (models.models_count + 1) * sizeof(models.indices_offsets[0]));
+    models_hash = hashBytes(models_hash, models.vertices, models.vertices_offsets[models.models_count] * sizeof(PosColorTexVertex));
+    models_hash = hashBytes(models_hash, models.indices, models.indices_offsets[models.models_count] * sizeof(uint16_t));
+  }
+  models_hash = hashVector(models_hash, tiles_bo.textures.mappings);
+
+  // same layers, order and states as the dynamic path in draw
+  baked.layers.assign(layers, layers + BX_COUNTOF(layers));
 }
 
 
 void World::init()
 {
   won = false;
+  // one loaded for this file just now is kept, anything else is stale
+  if (baked_key == 0 || baked_key != bakedKey()) {
+    baked.destroy();
+  }
+  state.init();
+
+  // editing the layout invalidates hints built for the saved level
+  if (!hints.empty() && hints.layout != Hints::layoutHash(state)) {
+    hints.clear();
+  }
+  updateHint();
   moving_nimate.reset();
   moving_clones_nimate.reset();
 
-  moving_positions.resize(moving_spots.size());
-  moving_clones_spots.resize(moving_spots.size());
+  moving_positions.resize(state.moving_spots.size());
+  moving_clones_spots.resize(state.moving_spots.size());
   moving_clones_positions.resize(moving_clones_spots.size());
-  static_positions.resize(static_spots.size());
-  doors_positions.resize(doors_spots.size());
-  winning_doors_positions.resize(winning_doors_spots.size());
-  tiles_positions.resize(tiles_spots.size());
+  static_positions.resize(state.static_spots.size());
+  doors_positions.resize(state.doors_spots.size());
+  winning_doors_positions.resize(state.winning_doors_spots.size());
+  tiles_positions.resize(state.tiles_spots.size());
   editor_position.resize(1);
-  moving_colors.resize(moving_spots.size());
-  static_colors.resize(static_spots.size());
-  doors_colors.resize(doors_spots.size());
-  winning_doors_colors.resize(winning_doors_spots.size());
-  tiles_colors.resize(tiles_spots.size());
+  moving_colors.resize(state.moving_spots.size());
+  static_colors.resize(state.static_spots.size());
+  doors_colors.resize(state.doors_spots.size());
+  winning_doors_colors.resize(state.winning_doors_spots.size());
+  tiles_colors.resize(state.tiles_spots.size());
   editor_color.resize(1);
-  through_door.resize(moving_spots.size());
-  moving_intermediate_spots.resize(moving_spots.size());
-  floor_positions.resize(floor_spots.size());
-  floor_colors.resize(floor_spots.size());
+  through_door.resize(state.moving_spots.size());
+  floor_positions.resize(state.floor_spots.size());
+  floor_colors.resize(state.floor_spots.size());
 
 
-  setPositionsFromSpots(moving_positions, moving_spots);
+  setPositionsFromSpots(moving_positions, state.moving_spots);
   fr(i, moving_clones_spots) {
     moving_clones_spots[i] = dead_spot;
   }
   setPositionsFromSpots(moving_clones_positions, moving_clones_spots);
-  setPositionsFromSpots(static_positions, static_spots);
-  setPositionsFromSpots(doors_positions, doors_spots);
-  setPositionsFromSpots(winning_doors_positions, winning_doors_spots);
-  setPositionsFromSpots(tiles_positions, tiles_spots);
+  setPositionsFromSpots(static_positions, state.static_spots);
+  setPositionsFromSpots(doors_positions, state.doors_spots);
+  setPositionsFromSpots(winning_doors_positions, state.winning_doors_spots);
+  setPositionsFromSpots(tiles_positions, state.tiles_spots);
   setPositionsFromSpots(editor_position, editor_spot);
-  setPositionsFromSpots(floor_positions, floor_spots);
+  setPositionsFromSpots(floor_positions, state.floor_spots);
 
   bg_positions.resize(1);
   bg_colors.resize(1);
@@ -502,8 +569,16 @@ void World::init()
 
   setColors(moving_colors, moving_color);
   setColors(static_colors, static_color);
+  // one colour per pair, numbered by the pair's first door
+  int pairs_count = 0;
   for (int i = 0; i < doors_colors.size(); ++i) {
-    doors_colors[i] = gate_colors[(int)(i / 2)];
+    int partner = state.doors_partners[i];
+    if (partner == -1 || partner > i) {
+      doors_colors[i] = gateColor(pairs_count++);
+      if (partner != -1) {
+        doors_colors[partner] = doors_colors[i];
+      }
+    }
   }
   setColors(winning_doors_colors, winning_doors_color);
   setColors(tiles_colors, tiles_color);
@@ -533,15 +608,12 @@ void World::init()
 
   writeModelsVertices(moving_bo, moving_positions, moving_colors, moving_models_list);
   writeModelsVertices(moving_clones_bo, moving_clones_positions, moving_colors, moving_models_list);
-  writeModelsVertices(static_bo, static_positions, static_colors, static_models_list);
-  writeModelsVertices(doors_bo, doors_positions, doors_colors, doors_models_list);
-  writeModelsVertices(winning_doors_bo, winning_doors_positions, winning_doors_colors, winning_doors_models_list);
-  writeFloorVertices(tiles_bo, tiles_positions, tiles_colors, tiles_mapping_ids);
   writeCubesVertices(editor_bo, editor_position, editor_color);
-  writeModelsVertices(floor_bo, floor_positions, floor_colors, floor_models_list);
-  writeModelsVertices(bg_bo, bg_positions, bg_colors, bg_models_list);
 
-  moving_next_spots = moving_spots;
+  static_stale = true;
+  if (editing) {
+    writeStaticVertices();
+  }
 
 
   moving_nimate.init();
@@ -553,14 +625,122 @@ void World::updateBuffers()
 {
   moving_bo.updateBuffer();
   moving_clones_bo.updateBuffer();
+  if (editing) {
+    updateStaticBuffers();
+  }
+
+  quads_bo.updateBuffer();
+}
+
+
+void World::updateStaticBuffers()
+{
   static_bo.updateBuffer();
   doors_bo.updateBuffer();
   winning_doors_bo.updateBuffer();
   tiles_bo.updateBuffer();
   floor_bo.updateBuffer();
   bg_bo.updateBuffer();
+}
 
-  quads_bo.updateBuffer();
+
+void World::writeStaticVertices()
+{
+  static_chunking.sort(static_positions, static_colors, state.static_models_list);
+  tiles_chunking.sort(tiles_positions, tiles_colors, state.tiles_mapping_ids);
+  floor_chunking.sort(floor_positions, floor_colors, state.floor_models_list);
+
+  writeModelsVertices(static_bo, static_chunking.positions, static_chunking.colors, static_chunking.models_list);
+  writeModelsVertices(doors_bo, doors_positions, doors_colors, doors_models_list);
+  writeModelsVertices(winning_doors_bo, winning_doors_positions, winning_doors_colors, winning_doors_models_list);
+  writeFloorVertices(tiles_bo, tiles_chunking.positions, tiles_chunking.colors, tiles_chunking.models_list);
+  writeModelsVertices(floor_bo, floor_chunking.positions, floor_chunking.colors, floor_chunking.models_list);
+  writeModelsVertices(bg_bo, bg_positions, bg_colors, bg_models_list);
+
+  static_stale = false;
+}
+
+
+void World::loadBaked(const char* level_path)
+{
+  baked.clear();
+
+  Baked::path(baked_str, level_path);
+  level_hash = 0;
+  baked_key = 0;
+
+  // the editor's layout only reaches the file once persisted
+  std::ifstream file(level_path, std::ios::binary);
+  if (editing || !file.is_open()) {
+    return;
+  }
+  file.seekg(0, std::ios::end);
+  size_t size = file.tellg();
+  file.seekg(0, std::ios::beg);
+
+  Arena::Scope scope(Arena::run());
+  char* data = Arena::run().alloc<char>(size);
+  file.read(data, size);
+
+  // never zero, that is no key
+  level_hash = hashBytes(models_hash, data, size) | 1;
+
+  uint64_t key = bakedKey();
+  if (baked.load(baked_str, key)) {
+    baked_key = key;
+  }
+}
+
+
+void World::bake()
+{
+  uint64_t key = bakedKey();
+  if (baked.active && baked_key == key && key != 0) {
+    return;
+  }
+
+  baked.clear();
+  baked_key = key;
+
+  if (key != 0 && baked_str[0] && baked.load(baked_str, key)) {
+    return;
+  }
+
+  if (static_stale) {
+    writeStaticVertices();
+  }
+
+  baked.addModelChunks(0, 0, static_chunking);
+  baked.addModels(1, BGFX_STATE_BLEND_ALPHA);
+  baked.addModels(2, BGFX_STATE_BLEND_ALPHA);
+  baked.addQuadChunks(3, 0, tiles_chunking);
+  baked.addModelChunks(4, 0, floor_chunking);
+  baked.addModels(5, 0);
+  baked.build();
+
+  if (key != 0 && baked_str[0]) {
+    baked.save(baked_str, key);
+  }
+}
+
+
+uint64_t World::bakedKey()
+{
+  // the file covers every placed thing, the colours are the rest of what
+  // writeStaticVertices reads, bg_color can be edited at runtime
+  if (level_hash == 0) {
+    return 0;
+  }
+
+  uint64_t h = level_hash;
+  h = hashBytes(h, &static_color, sizeof(static_color));
+  h = hashBytes(h, &winning_doors_color, sizeof(winning_doors_color));
+  h = hashBytes(h, &tiles_color, sizeof(tiles_color));
+  h = hashBytes(h, gate_colors, sizeof(gate_colors));
+  h = hashBytes(h, &floor_color, sizeof(floor_color));
+  h = hashBytes(h, &bg_color, sizeof(bg_color));
+
+  return h | 1;
 }
 
 void World::resolve
@@ -582,22 +762,23 @@ void World::resolve
 
   if (reset) {
     execute_reset();
-    return;
-  }
-
-  if (back) {
+  } else if (back) {
     execute_back();
-    return;
+  } else {
+    maybe_make_move(move);
   }
 
-  maybe_make_move(move);
+  // one table probe per move, nothing per frame
+  if (made_move) {
+    updateHint();
+  }
 }
 
 
 void World::update(const float t, const float dt)
 {
   if (made_move) {
-    positions_temp.resize(moving_spots.size());
+    positions_temp.resize(state.moving_spots.size());
     colors_temp.resize(moving_colors.size());
     models_temp.resize(moving_models_list.size());
 
@@ -610,7 +791,7 @@ void World::update(const float t, const float dt)
       models_temp[i] = 0;
     }
 
-    setPositionsFromSpots(positions_temp, moving_intermediate_spots);
+    setPositionsFromSpots(positions_temp, state.moving_intermediate_spots);
 
     animation_length = 300.0f;
     if (travel) { animation_length = 0.0f; }
@@ -623,21 +804,21 @@ void World::update(const float t, const float dt)
     acc_animation_length = t + animation_length * 1.5;
 
     if (any_through_door) {
-      fr(i, moving_intermediate_spots) {
+      fr(i, state.moving_intermediate_spots) {
         if (through_door[i]) {
-          equals_diff(moving_clones_spots[i], moving_spots[i], current_move);
+          equals_diff(moving_clones_spots[i], state.moving_spots[i], current_move);
         }
       }
       setPositionsFromSpots(moving_clones_positions, moving_clones_spots);
 
-      setPositionsFromSpots(positions_temp, moving_spots);
+      setPositionsFromSpots(positions_temp, state.moving_spots);
       fr(i, positions_temp) {
         if (through_door[i]) {
           moving_clones_nimate.schedule_position(i, positions_temp[i], t, acc_animation_length);
         }
       }
 
-      setPositionsFromSpots(positions_temp, moving_spots);
+      setPositionsFromSpots(positions_temp, state.moving_spots);
 
       fr(i, positions_temp) {
         if (through_door[i]) {
@@ -667,22 +848,50 @@ void World::update(const float t, const float dt)
 }
 
 
-void World::draw(const bool in_editor)
+void World::draw(const bool in_editor, const float* view_proj)
 {
-  moving_bo.drawModels(view, BGFX_STATE_BLEND_ALPHA);
-  moving_clones_bo.drawModels(view, BGFX_STATE_BLEND_ALPHA);
-  static_bo.drawModels(view, 0);
-  doors_bo.drawModels(view, BGFX_STATE_BLEND_ALPHA);
-  winning_doors_bo.drawModels(view, BGFX_STATE_BLEND_ALPHA);
-  tiles_bo.drawQuads(view, tiles_spots.size());
-  floor_bo.drawModels(view, 0);
-  bg_bo.drawModels(view, 0);
+  // entering the editor catches the dynamic buffers up, leaving it rebakes
+  if (in_editor != editing) {
+    editing = in_editor;
+    baked.destroy();
+    if (editing) {
+      // edits stop matching the file, bakes skip the cache until the next load
+      level_hash = 0;
+      if (static_stale) {
+        writeStaticVertices();
+      }
+      updateStaticBuffers();
+    }
+  }
+  if (!editing && !baked.active) {
+    bake();
+  }
 
-  quads_bo.drawQuads(view, quads_count);
+  queue.begin(view_proj);
+
+  queue.addModels(view, moving_bo, BGFX_STATE_BLEND_ALPHA);
+  queue.addModels(view, moving_clones_bo, BGFX_STATE_BLEND_ALPHA);
+  if (editing) {
+    queue.addModels(view, static_bo, 0);
+    queue.addModels(view, doors_bo, BGFX_STATE_BLEND_ALPHA);
+    queue.addModels(view, winning_doors_bo, BGFX_STATE_BLEND_ALPHA);
+    queue.addQuads(view, tiles_bo, state.tiles_spots.size());
+    queue.addModels(view, floor_bo, 0);
+    queue.addModels(view, bg_bo, 0);
+  } else {
+    if (view_proj) {
+      frustum.build(view_proj);
+    }
+    baked.draw(view, queue, view_proj ? &frustum : NULL);
+  }
+
+  queue.addQuads(view, quads_bo, quads_count);
 
   if (in_editor) {
-    editor_bo.drawCubes(view, 1, BGFX_STATE_BLEND_ALPHA);
+    queue.addCubes(view, editor_bo, 1, BGFX_STATE_BLEND_ALPHA);
   }
+
+  queue.submit();
 }
 
 
@@ -696,6 +905,7 @@ void World::destroy()
   editor_bo.destroy();
   floor_bo.destroy();
   bg_bo.destroy();
+  baked.destroy();
 }
 
 
@@ -705,15 +915,7 @@ void World::equals_diff(Spot& e, const Spot& s1, const Spot& s2) { e.x = s1.x -
 
 bool World::maybe_won()
 {
-  winning_count = 0;
-
-  fr(i, moving_spots) {
-    fr(j, winning_doors_spots) {
-      winning_count += same(moving_spots[i], winning_doors_spots[j]);
-    }
-  }
-
-  won = winning_count > 0 && winning_count == winning_doors_spots.size();
+  won = state.isWon();
 
   return won;
 }
@@ -721,50 +923,16 @@ bool World::maybe_won()
 
 void World::maybe_make_move(const Spot& move)
 {
-  if (move.x == 0 && move.y == 0) {
+  if (!state.apply(move)) {
     return;
   }
 
-  fr(i, moving_next_spots) {
-    equals_sum(moving_next_spots[i], moving_spots[i], move);
-  }
-
-  fr(i, moving_next_spots) {
-    on_floor = false;
-    fr(j, floor_spots) {
-      if (same(moving_next_spots[i], floor_spots[j])) {
-        on_floor = true;
-        continue;
-      }
-    }
-    if (!on_floor) {
-      return;
-    }
-  }
-
   made_move = true;
+  any_through_door = state.any_through_door;
 
-  maybe_doors();
-
-  all_moving_spots.push_back(moving_spots);
-  all_any_through_doors.push_back(any_through_door);
-  moving_spots = moving_next_spots;
-}
-
-
-void World::maybe_doors()
-{
-  fr(i, moving_next_spots) {
-    // through_door[i] = false;
-    moving_intermediate_spots[i] = moving_next_spots[i];
-    fr(j, doors_spots) {
-      if (same(moving_next_spots[i], doors_spots[j])) {
-        towards = (((j + 1) % 2) * 2) - 1;
-        moving_next_spots[i] = doors_spots[j + towards];
-        j += (j + 1) % 2;
-        through_door[i] = true;
-        any_through_door = true;
-      }
+  fr(i, state.teleported) {
+    if (state.teleported[i]) {
+      through_door[i] = true;
     }
   }
 }
@@ -772,14 +940,14 @@ void World::maybe_doors()
 
 void World::execute_back()
 {
+  if (!state.undo()) {
+    return;
+  }
+
   made_move = true;
-  moving_spots = all_moving_spots.back();
-  if (all_any_through_doors.back()) {
+  if (state.any_through_door) {
     travel = true;
   }
-  moving_intermediate_spots = moving_spots;
-  all_moving_spots.pop_back();
-  all_any_through_doors.pop_back();
 }
 
 
@@ -788,10 +956,31 @@ void World::execute_reset()
   made_move = true;
   travel = true;
   moving_nimate.reset();
-  moving_spots = all_moving_spots.front();
-  moving_intermediate_spots = moving_spots;
-  all_moving_spots.clear();
-  all_any_through_doors.clear();
+  state.reset();
+}
+
+
+bx::Vec3 World::gateColor(const int pair)
+{
+  if (pair < (int)BX_COUNTOF(gate_colors)) {
+    return gate_colors[pair];
+  }
+
+  // past the palette, golden ratio steps keep neighbouring hues apart
+  float hsv[3] = {bx::fract(pair * 0.618034f), 0.7f, 0.9f};
+  float rgb[3];
+  bx::hsvToRgb(rgb, hsv);
+
+  return bx::Vec3(rgb[0], rgb[1], rgb[2]);
+}
+
+
+void World::updateHint()
+{
+  if (!hints.lookup(state.moving_spots, hint_distance, hint_move)) {
+    hint_distance = -1;
+    hint_move = -1;
+  }
 }
 
 
@@ -866,25 +1055,45 @@ void World::writeModelsVertices
 void World::writeModelsVertices
 (BufferObject& bo, const std::vector<bx::Vec3>& positions, const std::vector<bx::Vec3>& colors, const std::vector<int>& models_list)
 {
-  if (positions.empty()) {
+  if (bo.instanced) {
+    bo.writeInstances(positions, colors, models_list);
+  } else if (positions.empty()) {
     bo.models_vertices_count = 0;
     bo.models_indices_count = 0;
   } else {
     int acc_vertices_offset = 0;
     int acc_indices_offset = 0;
+    bx::Vec3 zero(0.0f, 0.0f, 0.0f);
 
     for (int i = 0; i < positions.size(); ++i) {
-      bo.writeModelVertices(
-          acc_vertices_offset,
-          positions[i],
-          colors[i],
-          models_list[i]
-          );
-      bo.writeModelIndices(
-          acc_indices_offset,
-          acc_vertices_offset,
-          models_list[i]
-          );
+      // animated models rest where they are, nothing scheduled
+      if (bo.animations) {
+        bo.writeAnimatedModel(
+            i,
+            acc_vertices_offset,
+            acc_indices_offset,
+            positions[i],
+            positions[i],
+            colors[i],
+            colors[i],
+            models_list[i],
+            models_list[i],
+            zero,
+            zero
+            );
+      } else {
+        bo.writeModelVertices(
+            acc_vertices_offset,
+            positions[i],
+            colors[i],
+            models_list[i]
+            );
+        bo.writeModelIndices(
+            acc_indices_offset,
+            acc_vertices_offset,
+            models_list[i]
+            );
+      }
 
       acc_vertices_offset += bo.models.nth_model_vertices_count(models_list[i]);
       acc_indices_offset += bo.models.nth_model_indices_count(models_list[i]);
@@ -899,8 +1108,8 @@ void World::writeAnimatedModelsVertices
  const std::vector<bx::Vec3>& positions2,
  const std::vector<bx::Vec3>& colors1,
  const std::vector<bx::Vec3>& colors2,
- const std::vector<int> nth1s,
- const std::vector<int> nth2s,
+ const std::vector<int>& nth1s,
+ const std::vector<int>& nth2s,
  const std::vector<bx::Vec3>& froms,
  const std::vector<bx::Vec3>& tos
  )
@@ -913,8 +1122,10 @@ void World::writeAnimatedModelsVertices
     int acc_indices_offset = 0;
 
     for (int i = 0; i < positions1.size(); ++i) {
-      bo.writeModelVertices(
+      bo.writeAnimatedModel(
+          i,
           acc_vertices_offset,
+          acc_indices_offset,
           positions1[i],
           positions2[i],
           colors1[i],
@@ -924,14 +1135,9 @@ void World::writeAnimatedModelsVertices
           froms[i],
           tos[i]
           );
-      bo.writeModelIndices(
-          acc_indices_offset,
-          acc_vertices_offset,
-          nth1s[i]
-          );
 
       acc_vertices_offset += bo.models.nth_model_vertices_count(nth1s[i]);
-      acc_indices_offset += bo.models.nth_model_indices_count(nth2s[i]);
+      acc_indices_offset += bo.models.nth_model_indices_count(nth1s[i]);
     }
   }
 }
@@ -944,11 +1150,10 @@ void World::writeFloorVertices
  const std::vector<int>& mapping_ids
  )
 {
-  std::vector<bx::Vec3> tiles_vs;
-  std::vector<bx::Vec3> tiles_cs;
+  Arena::Scope scope(Arena::run());
+  bx::Vec3* tiles_vs = Arena::run().alloc<bx::Vec3>(mapping_ids.size() * 4);
+  bx::Vec3* tiles_cs = Arena::run().alloc<bx::Vec3>(mapping_ids.size() * 4);
   int tile_size = 1.0f;
-  tiles_vs.resize(mapping_ids.size() * 4);
-  tiles_cs.resize(mapping_ids.size() * 4);
 
   for (int i = 0; i < mapping_ids.size(); ++i) {
     tiles_vs[i * 4 + 0] = bx::Vec3(positions[i].x + tile_size, -1.0f, positions[i].z - tile_size);
@@ -961,5 +1166,5 @@ void World::writeFloorVertices
       tiles_cs[i * 4 + 3] = colors[i];
   }
 
-  bo.writeQuadsVertices(0, tiles_vs, tiles_cs, mapping_ids);
+  bo.writeQuadsVertices(0, tiles_vs, tiles_cs, mapping_ids.size() * 4, mapping_ids);
 }
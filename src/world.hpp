@@ -3,39 +3,30 @@
 #pragma once
 
 #include "buffer_object.hpp"
+#include "baked.hpp"
 #include "nimate.hpp"
 #include "models.hpp"
 #include "common.hpp"
+#include "world_state.hpp"
+#include "hints.hpp"
 #include <bx/math.h>
 
-#define fr(i, xs) for(int i = 0; i < xs.size(); ++i)
-
-struct Spot
-{
-  int x;
-  int y;
-};
-
 struct World
 {
   bgfx::ViewId view;
 
-  std::vector<Spot> moving_spots;
+  WorldState state;
+
+  // loaded by the caller next to the level, -1 distance when no hint applies
+  Hints hints;
+  int hint_distance;
+  int hint_move;
+
   std::vector<Spot> moving_clones_spots;
-  std::vector<Spot> moving_intermediate_spots;
-  std::vector<Spot> moving_next_spots;
-  std::vector<Spot> static_spots;
-  std::vector<Spot> doors_spots;
-  std::vector<Spot> winning_doors_spots;
-  std::vector<Spot> tiles_spots;
   std::vector<Spot> editor_spot;
-  std::vector<Spot> floor_spots;
 
   std::vector<int> through_door;
 
-  std::vector<std::vector<Spot>> all_moving_spots;
-  std::vector<bool> all_any_through_doors;
-
   std::vector<bx::Vec3> moving_positions;
   std::vector<bx::Vec3> moving_clones_positions;
   std::vector<bx::Vec3> moving_colors;
@@ -47,7 +38,6 @@ struct World
   std::vector<bx::Vec3> winning_doors_colors;
   std::vector<bx::Vec3> tiles_positions;
   std::vector<bx::Vec3> tiles_colors;
-  std::vector<int> tiles_mapping_ids;
   std::vector<bx::Vec3> editor_position;
   std::vector<bx::Vec3> editor_color;
   std::vector<bx::Vec3> floor_positions;
@@ -69,10 +59,33 @@ struct World
   BufferObject quads_bo;
   int quads_count = 2;
 
+  // everything but the moving layers, quads and editor cursor, rebaked on
+  // the first draw after init. The editor draws from the dynamic buffers,
+  // which only get their pending writes uploaded while it is open. Outside
+  // it init leaves the static layers unwritten until a bake misses the
+  // cache in baked_str, next to the level, empty for none. loadBaked keys
+  // it on the level file's bytes and checks it before the level is parsed,
+  // the editor drops the key since edits no longer match the file
+  Baked baked;
+  bool editing = false;
+  bool static_stale = true;
+  char baked_str[255] = "";
+  uint64_t models_hash = 0;
+  uint64_t level_hash = 0;
+  // what the active bake was loaded or built for
+  uint64_t baked_key = 0;
+
+  // static, tiles and floor are written chunk by chunk, the bake culls each
+  Chunking static_chunking;
+  Chunking tiles_chunking;
+  Chunking floor_chunking;
+  Frustum frustum;
+
+  // every layer goes through it, sorted and merged before submitting
+  RenderQueue queue;
+
 
-  std::vector<int> static_models_list;
   std::vector<int> moving_models_list;
-  std::vector<int> floor_models_list;
   std::vector<int> bg_models_list;
   std::vector<int> doors_models_list;
   std::vector<int> winning_doors_models_list;
@@ -103,11 +116,16 @@ struct World
   void prepare();
   void init();
   void updateBuffers();
+  void updateStaticBuffers();
+  void writeStaticVertices();
+  void loadBaked(const char* level_path);
+  void bake();
+  uint64_t bakedKey();
 
   void resolve(const Spot& move, const bool in_editor, const bool back, const bool reset);
   void update(const float t, const float dt);
 
-  void draw(const bool in_editor);
+  void draw(const bool in_editor, const float* view_proj = NULL);
   void destroy();
 
 
@@ -117,10 +135,11 @@ struct World
 
   bool maybe_won();
   void maybe_make_move(const Spot& move);
-  void maybe_doors();
   void execute_back();
   void execute_reset();
   void make_editor_move(const Spot& move);
+  void updateHint();
+  bx::Vec3 gateColor(const int pair);
 
   void setPositionsFromSpots(std::vector<bx::Vec3>& positions, const std::vector<Spot>& spots);
   void setColors(std::vector<bx::Vec3>& colors, const bx::Vec3& color);
@@ -133,8 +152,8 @@ struct World
      const std::vector<bx::Vec3>& positions2,
      const std::vector<bx::Vec3>& colors1,
      const std::vector<bx::Vec3>& colors2,
-     const std::vector<int> nth1s,
-     const std::vector<int> nth2s,
+     const std::vector<int>& nth1s,
+     const std::vector<int>& nth2s,
      const std::vector<bx::Vec3>& froms,
      const std::vector<bx::Vec3>& tos
     );
@@ -143,11 +162,9 @@ struct World
   template<class Archive>
   void serialize(Archive& archive)
   {
-    archive(moving_spots, static_spots, doors_spots, winning_doors_spots, tiles_spots, tiles_mapping_ids, static_models_list, floor_spots, floor_models_list);
+    state.serialize(archive);
   }
 
-  int towards;
-  int winning_count;
   bool made_move;
   Spot current_move;
   bool travel;
@@ -156,7 +173,6 @@ struct World
   float acc_animation_length;
   bool won;
   bool finished;
-  bool on_floor;
   std::vector<Spot> spots_temp;
   std::vector<bx::Vec3> positions_temp;
   std::vector<bx::Vec3> colors_temp;
@@ -0,0 +1,216 @@
+#include "world_state.hpp"
+
+
+void WorldState::prepare()
+{
+  moving_spots.reserve(100);
+  moving_next_spots.reserve(100);
+  moving_intermediate_spots.reserve(100);
+  static_spots.reserve(1000);
+  doors_spots.reserve(1000);
+  doors_partners.reserve(1000);
+  winning_doors_spots.reserve(100);
+  floor_spots.reserve(1000);
+  teleported.reserve(100);
+  initial_spots.reserve(100);
+  history_blocks.reserve(100);
+  history_doors.reserve(100);
+
+  history.init(undo_capacity);
+}
+
+
+void WorldState::init()
+{
+  pairDoors();
+  grid.build(floor_spots, static_spots, doors_spots, doors_partners, winning_doors_spots, moving_spots);
+
+  moving_next_spots = moving_spots;
+  moving_intermediate_spots = moving_spots;
+  teleported.assign(moving_spots.size(), false);
+  any_through_door = false;
+
+  // recorded deltas only make sense against the layout they were made on
+  clearHistory();
+}
+
+
+bool WorldState::apply(const Spot& move)
+{
+  any_through_door = false;
+
+  // only unit moves can be recorded for undo, this also rejects a zero move
+  int d = direction(move);
+  if (d == -1) {
+    return false;
+  }
+
+  fr(i, moving_next_spots) {
+    moving_next_spots[i].x = moving_spots[i].x + move.x;
+    moving_next_spots[i].y = moving_spots[i].y + move.y;
+
+    if (!grid.is(moving_next_spots[i], Grid::floor_cell)) {
+      return false;
+    }
+  }
+
+  history_blocks.clear();
+  history_doors.clear();
+
+  fr(i, moving_next_spots) {
+    moving_intermediate_spots[i] = moving_next_spots[i];
+    teleported[i] = false;
+
+    const Grid::Cell& cell = grid.at(moving_next_spots[i]);
+    if (cell.partner != -1) {
+      moving_next_spots[i] = doors_spots[cell.partner];
+      teleported[i] = true;
+      any_through_door = true;
+      history_blocks.push_back(i);
+      history_doors.push_back(cell.door);
+    }
+  }
+
+  history.push(d, history_blocks, history_doors);
+  moving_spots.swap(moving_next_spots);
+
+  return true;
+}
+
+
+bool WorldState::undo()
+{
+  int d;
+
+  if (!history.pop(d, history_blocks, history_doors)) {
+    return false;
+  }
+
+  fr(i, history_blocks) {
+    moving_spots[history_blocks[i]] = doors_spots[history_doors[i]];
+  }
+
+  fr(i, moving_spots) {
+    moving_spots[i].x -= directions[d].x;
+    moving_spots[i].y -= directions[d].y;
+  }
+
+  any_through_door = !history_blocks.empty();
+  moving_intermediate_spots = moving_spots;
+
+  return true;
+}
+
+
+bool WorldState::reset()
+{
+  if (history.empty()) {
+    return false;
+  }
+
+  moving_spots = initial_spots;
+  moving_intermediate_spots = moving_spots;
+  history.clear();
+
+  return true;
+}
+
+
+bool WorldState::isWon() const
+{
+  int winning_count = 0;
+
+  fr(i, moving_spots) {
+    winning_count += grid.at(moving_spots[i]).winning;
+  }
+
+  return winning_count > 0 && winning_count == (int)winning_doors_spots.size();
+}
+
+
+bool WorldState::canUndo() const
+{
+  return !history.empty();
+}
+
+
+void WorldState::clearHistory()
+{
+  initial_spots = moving_spots;
+  history.clear();
+}
+
+
+int WorldState::direction(const Spot& move)
+{
+  for (int i = 0; i < 4; ++i) {
+    if (directions[i].x == move.x && directions[i].y == move.y) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+
+void WorldState::pairDoors()
+{
+  if (doors_partners.size() != doors_spots.size()) {
+    // levels saved before the table existed paired doors by list position
+    doors_partners.resize(doors_spots.size());
+    fr(i, doors_partners) {
+      doors_partners[i] = i + (((i + 1) % 2) * 2) - 1;
+      if (doors_partners[i] >= (int)doors_partners.size()) {
+        doors_partners[i] = -1;
+      }
+    }
+  }
+
+  // a pair has to point both ways
+  fr(i, doors_partners) {
+    int partner = doors_partners[i];
+    if (partner < 0 || partner >= (int)doors_partners.size() || partner == i || doors_partners[partner] != i) {
+      doors_partners[i] = -1;
+    }
+  }
+}
+
+
+void WorldState::addDoor(const Spot& spot)
+{
+  pairDoors();
+
+  // pairs with the latest door still waiting for one
+  int partner = -1;
+  for (int i = doors_partners.size() - 1; i >= 0; --i) {
+    if (doors_partners[i] == -1) {
+      partner = i;
+      break;
+    }
+  }
+
+  doors_spots.push_back(spot);
+  doors_partners.push_back(partner);
+  if (partner != -1) {
+    doors_partners[partner] = doors_spots.size() - 1;
+  }
+}
+
+
+void WorldState::removeDoor(const int i)
+{
+  pairDoors();
+
+  if (doors_partners[i] != -1) {
+    doors_partners[doors_partners[i]] = -1;
+  }
+
+  doors_spots.erase(doors_spots.begin() + i);
+  doors_partners.erase(doors_partners.begin() + i);
+
+  fr(j, doors_partners) {
+    if (doors_partners[j] > i) {
+      doors_partners[j] -= 1;
+    }
+  }
+}
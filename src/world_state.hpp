@@ -0,0 +1,70 @@
+#ifndef WORLD_STATE
+#define WORLD_STATE
+#pragma once
+
+#include <vector>
+#include "grid.hpp"
+#include "undo_log.hpp"
+
+// l, r, u, d: the order the solver and the tools spell moves in
+static const Spot directions[4] = {{-1, 0}, {1, 0}, {0, 1}, {0, -1}};
+static const char directions_chars[] = "lrud";
+
+// Level layout plus the rules, with no rendering dependencies, so it can be
+// simulated without a bgfx context. World wraps it for drawing.
+struct WorldState
+{
+  std::vector<Spot> moving_spots;
+  std::vector<Spot> static_spots;
+  std::vector<Spot> doors_spots;
+  std::vector<Spot> winning_doors_spots;
+  std::vector<Spot> floor_spots;
+
+  // partner of each door, -1 when unpaired. Saved with the level, so
+  // removing one door leaves the other pairs alone.
+  std::vector<int> doors_partners;
+
+  // not used by the rules, kept so a state round-trips a level file
+  std::vector<Spot> tiles_spots;
+  std::vector<int> tiles_mapping_ids;
+  std::vector<int> static_models_list;
+  std::vector<int> floor_models_list;
+
+  Grid grid;
+
+  std::vector<Spot> moving_next_spots;
+  std::vector<Spot> moving_intermediate_spots;
+  std::vector<int> teleported;
+  bool any_through_door;
+
+  // history cap in 16 bit words, a plain move takes 2, each teleport 2 more
+  int undo_capacity = 1 << 16;
+  UndoLog history;
+  std::vector<Spot> initial_spots;
+  std::vector<int> history_blocks;
+  std::vector<int> history_doors;
+
+  void prepare();
+  void init();
+
+  bool apply(const Spot& move);
+  bool undo();
+  bool reset();
+  bool isWon() const;
+  bool canUndo() const;
+  void clearHistory();
+
+  void pairDoors();
+  void addDoor(const Spot& spot);
+  void removeDoor(const int i);
+
+  static int direction(const Spot& move);
+
+  template<class Archive>
+  void serialize(Archive& archive)
+  {
+    archive(moving_spots, static_spots, doors_spots, winning_doors_spots, tiles_spots, tiles_mapping_ids, static_models_list, floor_spots, floor_models_list, doors_partners);
+  }
+};
+
+#endif